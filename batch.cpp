@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/batch.h"
+#include <sstream>
+#include <boost/algorithm/string/trim.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+namespace{
+    const std::string crlf("\r\n");
+    
+    /**
+     * value of a parameter (e.g. boundary) of a header like multipart/form-data; boundary=XXX
+     */
+    std::string parameter(const std::string& header, const std::string& name){
+        std::size_t pos = header.find(name+"=");
+        if(pos == std::string::npos){
+            return std::string();
+        }
+        pos += name.size()+1;
+        std::size_t end = header.find(';', pos);
+        std::string value = header.substr(pos, end == std::string::npos ? std::string::npos : end - pos);
+        boost::trim_if(value, boost::is_any_of("\" "));
+        return value;
+    }
+}
+
+tash::batch::batch(tash::connection& conn, const std::string& boundary): _conn(conn), _boundary(boundary){}
+
+tash::batch& tash::batch::add(const tash::http_request_type& request){
+    _requests.push_back(request);
+    return *this;
+}
+
+tash::batch& tash::batch::add(std::string path, boost::beast::http::verb method){
+    return add(_conn.request(path, method));
+}
+
+tash::batch& tash::batch::add(std::string path, const std::string& content, std::string type, boost::beast::http::verb method){
+    // the parts are never compressed on their own, the enclosing request is compressed as a whole
+    tash::http_request_type part = _conn.request(path, method);
+    part.set(boost::beast::http::field::content_type, type);
+    part.set(boost::beast::http::field::content_length, std::to_string(content.size()));
+    part.body() = content;
+    return add(part);
+}
+
+void tash::batch::clear(){
+    _requests.clear();
+}
+
+tash::http_request_type tash::batch::request() const{
+    std::ostringstream body;
+    for(std::size_t i = 0; i < _requests.size(); ++i){
+        // the operations inherit the authentication of the enclosing request
+        tash::http_request_type part(_requests[i]);
+        part.erase(boost::beast::http::field::authorization);
+        part.erase(boost::beast::http::field::host);
+        part.erase(boost::beast::http::field::connection);
+        part.erase(boost::beast::http::field::accept_encoding);
+        body << "--" << _boundary << crlf;
+        body << "Content-Type: application/x-arango-batchpart" << crlf;
+        body << "Content-Id: " << (i+1) << crlf << crlf;
+        body << part << crlf;
+    }
+    body << "--" << _boundary << "--" << crlf;
+    return _conn.request("_api/batch", body.str(), "multipart/form-data; boundary="+_boundary, boost::beast::http::verb::post);
+}
+
+std::vector<tash::http_response_type> tash::batch::execute(){
+    return demultiplex(_conn.query(request()));
+}
+
+std::vector<tash::http_response_type> tash::batch::demultiplex(const tash::http_response_type& response) const{
+    std::vector<tash::http_response_type> responses(_requests.size());
+    for(tash::http_response_type& res: responses){
+        res.result(boost::beast::http::status::unknown);
+    }
+    std::string boundary = parameter(response[boost::beast::http::field::content_type].to_string(), "boundary");
+    if(boundary.empty()){
+        boundary = _boundary;
+    }
+    const std::string delimiter = "--"+boundary;
+    const std::string body = boost::beast::buffers_to_string(response.body().data());
+    std::size_t pos = body.find(delimiter);
+    std::size_t index = 0;
+    while(pos != std::string::npos){
+        pos += delimiter.size();
+        if(body.compare(pos, 2, "--") == 0){
+            break;
+        }
+        pos = body.find(crlf, pos);
+        if(pos == std::string::npos){
+            break;
+        }
+        pos += crlf.size();
+        std::size_t next = body.find(crlf+delimiter, pos);
+        if(next == std::string::npos){
+            break;
+        }
+        std::size_t headers_end = body.find(crlf+crlf, pos);
+        if(headers_end != std::string::npos && headers_end < next){
+            // parts are matched by Content-Id and fall back to their position when it is missing
+            std::size_t id = ++index;
+            std::istringstream headers(body.substr(pos, headers_end - pos));
+            std::string line;
+            while(std::getline(headers, line)){
+                if(boost::algorithm::istarts_with(line, "content-id:")){
+                    std::string value = line.substr(11);
+                    boost::trim(value);
+                    try{
+                        id = boost::lexical_cast<std::size_t>(value);
+                    }catch(const boost::bad_lexical_cast&){}
+                }
+            }
+            std::size_t begin = headers_end + 2*crlf.size();
+            if(id > 0 && id <= responses.size()){
+                boost::beast::http::response_parser<boost::beast::http::dynamic_body> parser;
+                parser.eager(true);
+                boost::system::error_code ec;
+                boost::asio::const_buffer buffer(body.data() + begin, next - begin);
+                while(buffer.size() > 0 && !parser.is_done()){
+                    std::size_t consumed = parser.put(buffer, ec);
+                    buffer += consumed;
+                    if(ec == boost::beast::http::error::need_more){
+                        ec = {};
+                        break;
+                    }
+                    if(ec || consumed == 0){
+                        break;
+                    }
+                }
+                if(!ec && !parser.is_done()){
+                    parser.put_eof(ec);
+                }
+                if(!ec){
+                    responses[id-1] = parser.release();
+                }
+            }
+        }
+        pos = next + crlf.size();
+    }
+    return responses;
+}
@@ -0,0 +1,339 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/cluster.h"
+#include <random>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/format.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+namespace{
+    /**
+     * a port number of 1 to 65535 given in decimal digits, 0 for anything else
+     */
+    unsigned port_number(const std::string& port){
+        if(port.empty() || port.size() > 5 || !std::all_of(port.begin(), port.end(), [](char c){return c >= '0' && c <= '9';})){
+            return 0;
+        }
+        unsigned long number = std::stoul(port);
+        return number <= 65535 ? static_cast<unsigned>(number) : 0;
+    }
+}
+
+tash::endpoint::endpoint(const std::string& host, unsigned port): _scheme("tcp"), _host(host), _port(port){}
+
+tash::endpoint tash::endpoint::parse(const std::string& str){
+    std::string scheme("tcp");
+    std::string rest(str);
+    std::size_t separator = str.find("://");
+    if(separator != std::string::npos){
+        scheme = str.substr(0, separator);
+        rest   = str.substr(separator+3);
+    }
+    if(scheme == "http" || scheme == "http+tcp"){
+        scheme = "tcp";
+    }
+    if(scheme == "vst+tcp"){
+        scheme = "vst";
+    }
+    if(scheme == "http+unix"){
+        scheme = "unix";
+    }
+    if(scheme == "https" || scheme == "http+ssl"){
+        scheme = "ssl";
+    }
+    if(scheme == "h2c" || scheme == "http2" || scheme == "h2+tcp"){
+        scheme = "h2";
+    }
+    if(scheme != "tcp" && scheme != "vst" && scheme != "h2" && scheme != "unix" && scheme != "ssl"){
+        throw std::invalid_argument("unsupported endpoint "+str);
+    }
+    if(scheme == "unix"){
+        // unix:///tmp/arangodb.sock, the path is absolute
+        if(!boost::algorithm::starts_with(rest, "/")){
+            throw std::invalid_argument("malformed endpoint "+str);
+        }
+        tash::endpoint ep(rest, 0);
+        ep._scheme = scheme;
+        return ep;
+    }
+    std::size_t slash = rest.find('/');
+    if(slash != std::string::npos){
+        rest = rest.substr(0, slash);
+    }
+    std::string host;
+    std::string port;
+    if(boost::algorithm::starts_with(rest, "[")){
+        // [::1]:8529
+        std::size_t close = rest.find(']');
+        if(close == std::string::npos){
+            throw std::invalid_argument("malformed endpoint "+str);
+        }
+        host = rest.substr(1, close-1);
+        if(close+1 < rest.size() && rest[close+1] == ':'){
+            port = rest.substr(close+2);
+        }
+    }else{
+        std::size_t colon = rest.rfind(':');
+        host = rest.substr(0, colon);
+        if(colon != std::string::npos){
+            port = rest.substr(colon+1);
+        }
+    }
+    if(host.empty()){
+        throw std::invalid_argument("malformed endpoint "+str);
+    }
+    unsigned number = port.empty() ? 8529 : port_number(port);
+    if(number == 0){
+        throw std::invalid_argument("malformed endpoint "+str);
+    }
+    tash::endpoint ep(host, number);
+    ep._scheme = scheme;
+    return ep;
+}
+
+std::string tash::endpoint::transport() const{
+    if(_scheme == "vst" || _scheme == "h2"){
+        return _scheme;
+    }
+    return "http";
+}
+
+std::string tash::endpoint::to_string() const{
+    if(local()){
+        return _scheme + "://" + _host;
+    }
+    if(_host.find(':') != std::string::npos){
+        return (boost::format("%1%://[%2%]:%3%") % _scheme % _host % _port).str();
+    }
+    return (boost::format("%1%://%2%:%3%") % _scheme % _host % _port).str();
+}
+
+bool tash::endpoint::operator==(const tash::endpoint& other) const{
+    return _scheme == other._scheme && _host == other._host && _port == other._port;
+}
+
+tash::node::node(boost::asio::io_context& io, const tash::endpoint& ep): _endpoint(ep), _dns(io, ep.host(), ep.port()), _pool(io), _outstanding(0), _healthy(true), _latency(0.0), _requests(0), _failures(0){
+    if(ep.local()){
+        _dns.pin(boost::asio::local::stream_protocol::endpoint(ep.host()));
+    }
+}
+
+bool tash::node::available() const{
+    if(_breaker.current() == tash::breaker::state::open){
+        return false;
+    }
+    boost::mutex::scoped_lock lock(_mutex);
+    return _healthy && clock_type::now() >= _quarantine;
+}
+
+void tash::node::healthy(bool flag){
+    boost::mutex::scoped_lock lock(_mutex);
+    _healthy = flag;
+    if(flag){
+        _quarantine = clock_type::time_point();
+    }
+}
+
+void tash::node::quarantine(clock_type::duration period){
+    boost::mutex::scoped_lock lock(_mutex);
+    _quarantine = clock_type::now() + period;
+}
+
+std::chrono::microseconds tash::node::latency() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return std::chrono::microseconds(static_cast<std::chrono::microseconds::rep>(_latency));
+}
+
+boost::system::error_code tash::node::begin(){
+    if(!_breaker.allow()){
+        return boost::asio::error::host_unreachable;
+    }
+    if(!_limiter.acquire()){
+        _breaker.discard();
+        return boost::asio::error::try_again;
+    }
+    ++_outstanding;
+    return boost::system::error_code();
+}
+
+void tash::node::end(clock_type::duration elapsed, bool success, bool counted){
+    --_outstanding;
+    if(counted){
+        _limiter.release(elapsed, success);
+        _breaker.record(success);
+    }else{
+        _limiter.release();
+        _breaker.discard();
+        return;
+    }
+    boost::mutex::scoped_lock lock(_mutex);
+    ++_requests;
+    if(!success){
+        ++_failures;
+        return;
+    }
+    double sample = std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(elapsed).count();
+    _latency = (_latency == 0.0) ? sample : 0.8 * _latency + 0.2 * sample;
+}
+
+tash::node::statistics tash::node::stats() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    statistics stats;
+    stats.endpoint    = _endpoint.to_string();
+    stats.healthy     = _healthy && clock_type::now() >= _quarantine;
+    stats.outstanding = _outstanding;
+    stats.requests    = _requests;
+    stats.failures    = _failures;
+    stats.latency     = std::chrono::microseconds(static_cast<std::chrono::microseconds::rep>(_latency));
+    stats.limit       = _limiter.limit();
+    stats.rejected    = _limiter.stats().rejected + _breaker.stats().rejected;
+    stats.circuit     = _breaker.current();
+    return stats;
+}
+
+tash::balancer::balancer(): _policy(policy::round_robin), _quarantine(std::chrono::seconds(5)), _next(0){}
+
+tash::balancer::policy tash::balancer::balancing() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _policy;
+}
+
+tash::balancer& tash::balancer::balancing(policy p){
+    boost::mutex::scoped_lock lock(_mutex);
+    _policy = p;
+    return *this;
+}
+
+tash::balancer& tash::balancer::limiting(const tash::limiter::settings& s){
+    for(const node_ptr& n: nodes()){
+        n->limiter().configure(s);
+    }
+    return *this;
+}
+
+tash::balancer& tash::balancer::breaking(const tash::breaker::settings& s){
+    for(const node_ptr& n: nodes()){
+        n->breaker().configure(s);
+    }
+    return *this;
+}
+
+tash::node::clock_type::duration tash::balancer::quarantine() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _quarantine;
+}
+
+tash::balancer& tash::balancer::quarantine(node::clock_type::duration period){
+    boost::mutex::scoped_lock lock(_mutex);
+    _quarantine = period;
+    return *this;
+}
+
+tash::node_ptr tash::balancer::add(boost::asio::io_context& io, const tash::endpoint& ep){
+    boost::mutex::scoped_lock lock(_mutex);
+    for(const node_ptr& n: _nodes){
+        if(n->endpoint() == ep){
+            return n;
+        }
+    }
+    node_ptr n(new tash::node(io, ep));
+    if(!_nodes.empty()){
+        // discovered nodes are configured like the first one
+        node_ptr first = _nodes.front();
+        n->pool().capacity(first->pool().capacity()).max_idle(first->pool().max_idle());
+        n->dns().ttl(first->dns().ttl());
+        n->limiter().configure(first->limiter().configuration());
+        n->breaker().configure(first->breaker().configuration());
+    }
+    _nodes.push_back(n);
+    return n;
+}
+
+std::vector<tash::node_ptr> tash::balancer::nodes() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _nodes;
+}
+
+tash::node_ptr tash::balancer::pick(const std::vector<node_ptr>& excluded){
+    std::vector<node_ptr> candidates;
+    std::vector<node_ptr> fallback;
+    policy p;
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        p = _policy;
+        for(const node_ptr& n: _nodes){
+            if(std::find(excluded.begin(), excluded.end(), n) != excluded.end()){
+                continue;
+            }
+            (n->available() ? candidates : fallback).push_back(n);
+        }
+    }
+    if(candidates.empty()){
+        candidates.swap(fallback);
+    }
+    if(candidates.empty()){
+        return node_ptr();
+    }
+    std::size_t start = _next++ % candidates.size();
+    if(p == policy::round_robin || candidates.size() == 1){
+        return candidates[start];
+    }
+    if(p == policy::least_outstanding){
+        // ties are broken in round robin order
+        node_ptr chosen;
+        for(std::size_t i = 0; i < candidates.size(); ++i){
+            const node_ptr& n = candidates[(start+i) % candidates.size()];
+            if(!chosen || n->outstanding() < chosen->outstanding()){
+                chosen = n;
+            }
+        }
+        return chosen;
+    }
+    // latency weighted: random choice with probability inversely proportional to the latency, nodes without samples get the best weight
+    std::vector<double> latencies;
+    double best = std::numeric_limits<double>::max();
+    for(const node_ptr& n: candidates){
+        double latency = static_cast<double>(n->latency().count());
+        latencies.push_back(latency);
+        if(latency > 0.0 && latency < best){
+            best = latency;
+        }
+    }
+    if(best == std::numeric_limits<double>::max()){
+        best = 1.0;
+    }
+    std::vector<double> weights;
+    for(double latency: latencies){
+        weights.push_back(1.0 / (latency > 0.0 ? latency : best));
+    }
+    static thread_local std::mt19937 generator(std::random_device{}());
+    std::discrete_distribution<std::size_t> distribution(weights.begin(), weights.end());
+    return candidates[distribution(generator)];
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/compression.h"
+#include <stdexcept>
+#include <boost/algorithm/string/predicate.hpp>
+#if defined(TASH_WITH_ZLIB)
+#include <zlib.h>
+#endif
+
+tash::compression::compression(bool accept, std::size_t threshold, int level): accept(accept), threshold(threshold), level(level){}
+
+bool tash::compression::available(){
+#if defined(TASH_WITH_ZLIB)
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if defined(TASH_WITH_ZLIB)
+
+namespace{
+    const std::size_t chunk_size = 16384;
+    
+    /**
+     * zlib stream that is released when it goes out of scope
+     */
+    class inflater{
+        z_stream    _stream;
+      public:
+        explicit inflater(int window){
+            _stream = z_stream();
+            if(inflateInit2(&_stream, window) != Z_OK){
+                throw std::runtime_error("failed to initialize zlib");
+            }
+        }
+        ~inflater(){
+            inflateEnd(&_stream);
+        }
+        z_stream& stream(){return _stream;}
+    };
+    
+    /**
+     * inflates every buffer of the body into decoded, returns false if the data is not in the expected format
+     */
+    template <typename BufferSequence>
+    bool inflate(const BufferSequence& body, int window, boost::beast::multi_buffer& decoded){
+        inflater z(window);
+        unsigned char chunk[chunk_size];
+        int status = Z_OK;
+        for(const boost::asio::const_buffer& buffer: boost::beast::buffers_range_ref(body)){
+            z.stream().next_in  = static_cast<Bytef*>(const_cast<void*>(buffer.data()));
+            z.stream().avail_in = static_cast<uInt>(buffer.size());
+            while(z.stream().avail_in > 0 && status != Z_STREAM_END){
+                z.stream().next_out  = chunk;
+                z.stream().avail_out = chunk_size;
+                status = ::inflate(&z.stream(), Z_NO_FLUSH);
+                if(status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR){
+                    return false;
+                }
+                std::size_t produced = chunk_size - z.stream().avail_out;
+                decoded.commit(boost::asio::buffer_copy(decoded.prepare(produced), boost::asio::buffer(chunk, produced)));
+            }
+        }
+        return status == Z_STREAM_END;
+    }
+}
+
+std::string tash::gzip(boost::beast::string_view content, int level){
+    z_stream stream = z_stream();
+    // 16 added to the window bits selects the gzip wrapper
+    if(deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK){
+        throw std::runtime_error("failed to initialize zlib");
+    }
+    std::string encoded;
+    encoded.resize(deflateBound(&stream, static_cast<uLong>(content.size())));
+    stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(content.data()));
+    stream.avail_in  = static_cast<uInt>(content.size());
+    stream.next_out  = reinterpret_cast<Bytef*>(&encoded[0]);
+    stream.avail_out = static_cast<uInt>(encoded.size());
+    int status = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if(status != Z_STREAM_END){
+        throw std::runtime_error("failed to gzip request body");
+    }
+    encoded.resize(stream.total_out);
+    return encoded;
+}
+
+bool tash::decode(boost::beast::http::response<boost::beast::http::dynamic_body>& response){
+    auto encoding = response.find(boost::beast::http::field::content_encoding);
+    if(encoding == response.end()){
+        return false;
+    }
+    int window;
+    if(boost::algorithm::iequals(encoding->value(), "gzip") || boost::algorithm::iequals(encoding->value(), "x-gzip")){
+        window = 15 + 16;
+    }else if(boost::algorithm::iequals(encoding->value(), "deflate")){
+        // deflate is meant to be zlib wrapped, 32 added to the window bits detects the wrapper
+        window = 15 + 32;
+    }else{
+        return false;
+    }
+    boost::beast::multi_buffer decoded;
+    if(!inflate(response.body().data(), window, decoded)){
+        // some servers send deflate without the zlib wrapper
+        decoded.consume(decoded.size());
+        if(window != 15 + 32 || !inflate(response.body().data(), -15, decoded)){
+            throw std::runtime_error("invalid "+std::string(encoding->value())+" encoded response body");
+        }
+    }
+    response.body() = std::move(decoded);
+    response.erase(boost::beast::http::field::content_encoding);
+    response.prepare_payload();
+    return true;
+}
+
+#else
+
+std::string tash::gzip(boost::beast::string_view, int){
+    throw std::logic_error("tash was built without zlib");
+}
+
+bool tash::decode(boost::beast::http::response<boost::beast::http::dynamic_body>&){
+    return false;
+}
+
+#endif
@@ -27,80 +27,1208 @@
 
 #include "tash/connection.h"
 #include "tash/query.h"
+#include "tash/reader.h"
 #include <boost/format.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/algorithm/string/trim.hpp>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/asio/buffer.hpp>
+#include <boost/asio/buffers_iterator.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <array>
+#include <deque>
+#include <memory>
+#include <exception>
+#include <istream>
+#include <streambuf>
+#include <algorithm>
+#include <cstdio>
 #include <basen.hpp>
 
 namespace http = boost::beast::http;
 
-tash::connection::connection(const std::string& db, std::string host, unsigned int port, std::string user, std::string pass): _host(host), _port(port), _user(user), _pass(pass), _db(db), _resolver(_io){
-    
+tash::connection::connection(const std::string& db, std::string host, unsigned int port, std::string user, std::string pass): connection(boost::make_shared<tash::executor>(), db, host, port, user, pass){}
+
+tash::connection::connection(const std::string& db, const std::vector<std::string>& endpoints, std::string user, std::string pass): connection(boost::make_shared<tash::executor>(), db, endpoints, user, pass){}
+
+tash::connection::connection(boost::shared_ptr<tash::executor> executor, const std::string& db, std::string host, unsigned int port, std::string user, std::string pass): _executor(executor), _io(executor->io()), _host(host), _port(port), _user(user), _pass(pass), _db(db), _velocypack(false), _bearer(false){
+    _primary = join(tash::endpoint(host, port));
+    prepare();
+}
+
+tash::connection::connection(boost::shared_ptr<tash::executor> executor, const std::string& db, const std::vector<std::string>& endpoints, std::string user, std::string pass): _executor(executor), _io(executor->io()), _port(0), _user(user), _pass(pass), _db(db), _velocypack(false), _bearer(false){
+    for(const std::string& str: endpoints){
+        tash::node_ptr n = join(tash::endpoint::parse(str));
+        if(!_primary){
+            _primary = n;
+        }
+    }
+    if(!_primary){
+        throw std::invalid_argument("no endpoint to connect to");
+    }
+    _host = _primary->endpoint().local() ? std::string("localhost") : _primary->endpoint().host();
+    _port = _primary->endpoint().port();
+    prepare();
+}
+
+tash::connection& tash::connection::threads(std::size_t count){
+    _executor->start(count);
+    return *this;
+}
+
+tash::node_ptr tash::connection::join(const tash::endpoint& ep){
+    if(_primary && _primary->endpoint().transport() != ep.transport()){
+        throw std::invalid_argument("all endpoints of a connection have to use the same transport");
+    }
+    tash::node_ptr n = _balancer.add(_io, ep);
+    if(ep.scheme() == "vst" && !n->stream()){
+        n->stream(boost::make_shared<tash::velocystream>(n->dns(), _user, _pass));
+    }
+    if(ep.scheme() == "h2" && !n->stream()){
+        n->stream(boost::make_shared<tash::http2>(n->dns()));
+    }
+    if(ep.secure() && !n->tls()){
+        if(!_tls){
+            _tls = tash::tls::client();
+        }
+        n->tls(boost::make_shared<tash::tls>(_tls, ep.host()));
+    }
+    return n;
+}
+
+tash::connection& tash::connection::tls(boost::shared_ptr<boost::asio::ssl::context> context){
+    _tls = context;
+    for(const tash::node_ptr& n: _balancer.nodes()){
+        if(n->endpoint().secure()){
+            n->pool().clear();
+            n->tls(boost::make_shared<tash::tls>(_tls, n->endpoint().host()));
+        }
+    }
+    return *this;
+}
+
+tash::connection::~connection(){
+    health_checks(std::chrono::milliseconds(0));
+    if(_renewal.joinable()){
+        // a login in flight is no interruption point, it is aborted through the token
+        _renewal_token.cancel();
+        _renewal.interrupt();
+        _renewal.join();
+    }
+    if(_executor.unique()){
+        // the workers of an executor of its own must not run handlers while the members are destroyed
+        _executor->stop();
+    }
+}
+
+void tash::connection::prepare(){
+    // the credentials and the database rarely change, so the Authorization header and the database prefix are built once
+    // and replaced as a whole when a token is renewed, requests in flight keep the strings they started with
+    std::string authorization;
+    if(_token.empty()){
+        std::string b64_encoded_credentials;
+        std::string credentials = _user + ":" + _pass;
+        bn::encode_b64(credentials.begin(), credentials.end(), back_inserter(b64_encoded_credentials));
+        authorization = "Basic " + b64_encoded_credentials;
+    }else{
+        authorization = "bearer " + _token;
+    }
+    _prefix = "/_db/" + _db + "/";
+    std::string preamble = "Host: " + _host + "\r\nAuthorization: " + authorization + "\r\nConnection: keep-alive\r\n";
+    if(_compression.accept){
+        preamble += "Accept-Encoding: gzip, deflate\r\n";
+    }
+    if(_velocypack){
+        preamble += "Accept: application/x-velocypack\r\n";
+    }
+    boost::atomic_store(&_authorization, boost::make_shared<const std::string>(std::move(authorization)));
+    boost::atomic_store(&_preamble, boost::make_shared<const std::string>(std::move(preamble)));
+}
+
+namespace{
+    /**
+     * the exp claim of a JSON web token, the epoch if the token has none
+     */
+    std::chrono::system_clock::time_point expiry(const std::string& token){
+        std::size_t first  = token.find('.');
+        std::size_t second = token.find('.', first == std::string::npos ? first : first+1);
+        if(first == std::string::npos || second == std::string::npos){
+            return std::chrono::system_clock::time_point();
+        }
+        // base64url to base64
+        std::string payload = token.substr(first+1, second-first-1);
+        std::replace(payload.begin(), payload.end(), '-', '+');
+        std::replace(payload.begin(), payload.end(), '_', '/');
+        std::string decoded;
+        bn::decode_b64(payload.begin(), payload.end(), back_inserter(decoded));
+        try{
+            nlohmann::json claims = nlohmann::json::parse(decoded);
+            if(claims.count("exp") && claims["exp"].is_number()){
+                return std::chrono::system_clock::time_point(std::chrono::seconds(claims["exp"].get<long long>()));
+            }
+        }catch(const std::exception&){}
+        return std::chrono::system_clock::time_point();
+    }
+}
+
+tash::connection& tash::connection::jwt(std::chrono::seconds renew){
+    if(_primary->endpoint().scheme() == "vst"){
+        throw std::logic_error("VelocyStream authenticates once per connection, JWT is only supported over HTTP");
+    }
+    if(_renewal.joinable()){
+        _renewal_token.cancel();
+        _renewal.interrupt();
+        _renewal.join();
+    }
+    _renewal_token = tash::cancellation();
+    {
+        boost::mutex::scoped_lock lock(_login_mutex);
+        login(tash::request_options(_timeouts));
+    }
+    _bearer = true;
+    _renewal = boost::thread([this, renew](){
+        try{
+            while(true){
+                std::chrono::system_clock::time_point due;
+                {
+                    boost::mutex::scoped_lock lock(_auth_mutex);
+                    due = _expiry - renew;
+                    if(_expiry == std::chrono::system_clock::time_point()){
+                        // the server did not say when the token expires
+                        due = std::chrono::system_clock::now() + std::chrono::minutes(30);
+                    }else if(due <= std::chrono::system_clock::now()){
+                        // the token lives shorter than the renewal margin, it is renewed half way through
+                        due = std::chrono::system_clock::now() + (_expiry - std::chrono::system_clock::now()) / 2;
+                    }
+                }
+                auto pause = std::chrono::duration_cast<std::chrono::milliseconds>(due - std::chrono::system_clock::now());
+                boost::this_thread::sleep(boost::posix_time::milliseconds(std::max<long long>(pause.count(), 1000)));
+                try{
+                    boost::mutex::scoped_lock lock(_login_mutex);
+                    login(tash::request_options(_timeouts, _renewal_token));
+                }catch(const std::exception&){
+                    // the current token may still be valid, the next attempt follows after a short pause
+                    boost::this_thread::sleep(boost::posix_time::seconds(5));
+                }
+            }
+        }catch(const boost::thread_interrupted&){}
+    });
+    return *this;
+}
+
+std::string tash::connection::token() const{
+    boost::mutex::scoped_lock lock(_auth_mutex);
+    return _token;
+}
+
+std::string tash::connection::authorization() const{
+    return *boost::atomic_load(&_authorization);
+}
+
+tash::http_request_type tash::connection::credentials() const{
+    return request("/_open/auth", nlohmann::json{{"username", _user}, {"password", _pass}}.dump());
+}
+
+bool tash::connection::renew(const tash::http_response_type& response){
+    if(response.result() != http::status::ok){
+        return false;
+    }
+    std::string token = parse(response).value("jwt", std::string());
+    if(token.empty()){
+        return false;
+    }
+    boost::mutex::scoped_lock lock(_auth_mutex);
+    _token  = token;
+    _expiry = expiry(token);
+    prepare();
+    return true;
+}
+
+void tash::connection::login(const tash::request_options& options){
+    tash::node_ptr target;
+    tash::http_response_type response = deliver(credentials(), target, options, false);
+    if(!renew(response)){
+        throw std::runtime_error("JWT login failed: "+std::string(response.reason()));
+    }
+}
+
+bool tash::connection::reauthenticate(boost::beast::string_view used){
+    if(!_bearer){
+        return false;
+    }
+    boost::mutex::scoped_lock lock(_login_mutex);
+    if(*boost::atomic_load(&_authorization) != used){
+        // another thread renewed the token in the meantime
+        return true;
+    }
+    try{
+        login(tash::request_options(_timeouts));
+    }catch(const std::exception&){
+        return false;
+    }
+    return true;
+}
+
+tash::connection& tash::connection::compression(const tash::compression& settings){
+    if((settings.accept || settings.threshold > 0) && !tash::compression::available()){
+        throw std::logic_error("tash was built without zlib");
+    }
+    boost::mutex::scoped_lock lock(_auth_mutex);
+    _compression = settings;
+    prepare();
+    return *this;
+}
+
+tash::connection& tash::connection::velocypack(bool enabled){
+    boost::mutex::scoped_lock lock(_auth_mutex);
+    _velocypack = enabled;
+    prepare();
+    return *this;
+}
+
+tash::connection& tash::connection::timeouts(const tash::timeouts& limits){
+    _timeouts = limits;
+    return *this;
+}
+
+tash::connection& tash::connection::retries(const tash::retry_policy& policy){
+    _retry = policy;
+    _budget.configure(policy.budget, policy.refill);
+    return *this;
+}
+
+std::string tash::connection::serialize(const nlohmann::json& document) const{
+    return _velocypack ? tash::vpack::encode(document) : document.dump();
+}
+
+std::string tash::connection::content_type() const{
+    return _velocypack ? "application/x-velocypack" : "application/json";
+}
+
+nlohmann::json tash::connection::parse(const tash::http_response_type& response){
+    const auto body = response.body().data();
+    const bool velocypack = boost::algorithm::istarts_with(response[boost::beast::http::field::content_type], "application/x-velocypack");
+    if(std::next(boost::asio::buffer_sequence_begin(body)) == boost::asio::buffer_sequence_end(body)){
+        // both parsers need contiguous input, a body received into a single buffer is used in place
+        boost::asio::const_buffer buffer = *boost::asio::buffer_sequence_begin(body);
+        const char* begin = static_cast<const char*>(buffer.data());
+        if(velocypack){
+            return tash::vpack::decode(reinterpret_cast<const std::uint8_t*>(begin), buffer.size());
+        }
+        return nlohmann::json::parse(begin, begin + buffer.size());
+    }
+    std::string bytes = boost::beast::buffers_to_string(body);
+    return velocypack ? tash::vpack::decode(bytes) : nlohmann::json::parse(bytes);
 }
 
 tash::http_request_type tash::connection::url(boost::beast::http::verb method, std::string path) const{
-    std::string b64_encoded_credentials;
     boost::trim_left_if(path, boost::is_any_of("/ "));
-    tash::http_request_type request(method, "/"+path, 10);
-    std::string credentials = (boost::format("%1%:%2%") % _user % _pass).str();
-    bn::encode_b64(credentials.begin(), credentials.end(), back_inserter(b64_encoded_credentials));
-    request.set(boost::beast::http::field::authorization, "Basic " + b64_encoded_credentials);
+    path.insert(path.begin(), '/');
+    tash::http_request_type request(method, path, 11);
+    request.set(boost::beast::http::field::host, _host);
+    request.keep_alive(true);
+    request.set(boost::beast::http::field::authorization, *boost::atomic_load(&_authorization));
+    if(_compression.accept){
+        request.set(boost::beast::http::field::accept_encoding, "gzip, deflate");
+    }
+    if(_velocypack){
+        request.set(boost::beast::http::field::accept, "application/x-velocypack");
+    }
     return request;
 }
 
 tash::http_request_type tash::connection::db_url(boost::beast::http::verb method, std::string path) const{
     boost::trim_left_if(path, boost::is_any_of("/ "));
-    return url(method, (boost::format("/_db/%1%/%2%") % _db % path).str());
+    return url(method, path.insert(0, _prefix));
 }
 
-tash::http_response_type tash::connection::query(const tash::http_request_type& request){
-    boost::mutex::scoped_lock lock(_mutex);
-    auto const results = _resolver.resolve(_host, boost::lexical_cast<std::string>(_port));
-    boost::asio::ip::tcp::socket socket(_io);
-    boost::asio::connect(socket, results.begin(), results.end());
-    boost::beast::http::write(socket, request);
-    boost::beast::flat_buffer buffer;
+namespace{
+    /**
+     * serialized head and content of a request sent through connection::send()
+     */
+    typedef std::array<boost::asio::const_buffer, 2> wire_type;
+    
+    void write(tash::channel_stream& stream, const tash::http_request_type& request, boost::system::error_code& ec){
+        boost::beast::http::write(stream, request, ec);
+    }
+    
+    void write(tash::channel_stream& stream, const wire_type& wire, boost::system::error_code& ec){
+        boost::asio::write(stream, wire, ec);
+    }
+    
+    tash::http_response_type over_stream(tash::multiplexer& stream, const tash::http_request_type& request, const tash::deadline& deadline){
+        return stream.send(request, deadline);
+    }
+    
+    tash::http_response_type over_stream(tash::multiplexer&, const wire_type&, const tash::deadline&){
+        throw std::logic_error("serialized HTTP/1.1 requests cannot be sent over a multiplexed stream");
+    }
+    
+    template <typename MessageT>
+    void exchange(tash::channel& ch, const MessageT& message, boost::beast::flat_buffer& buffer, tash::http_response_type& response, const tash::deadline& deadline, boost::system::error_code& ec){
+        tash::channel_stream stream(ch, deadline);
+        write(stream, message, ec);
+        if(!ec){
+            boost::beast::http::read(stream, buffer, response, ec);
+        }
+    }
+    
+    /**
+     * whether the policy, the budget and the deadline allow another attempt after the given one, and the pause before it
+     */
+    bool again(const tash::retry_policy& policy, tash::retry_budget& budget, std::size_t attempt, const tash::deadline& deadline, std::chrono::milliseconds& pause){
+        if(attempt >= policy.attempts || deadline.check(deadline.total())){
+            return false;
+        }
+        pause = policy.backoff(attempt);
+        if(deadline.total() != tash::deadline::clock_type::time_point::max() && tash::deadline::clock_type::now() + pause >= deadline.total()){
+            // the retry could not complete in time anyway
+            return false;
+        }
+        return budget.withdraw();
+    }
+    
+    /**
+     * sleeps for the pause before a retry, cut short if the request is cancelled
+     */
+    boost::system::error_code pace(std::chrono::milliseconds pause, const tash::deadline& deadline){
+        const tash::deadline::clock_type::time_point until = tash::deadline::clock_type::now() + pause;
+        // a cancellable wait wakes up regularly to look at the token
+        const std::chrono::milliseconds slice(50);
+        while(true){
+            boost::system::error_code ec = deadline.check(deadline.total());
+            if(ec){
+                return ec;
+            }
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(until - tash::deadline::clock_type::now());
+            if(remaining.count() <= 0){
+                return ec;
+            }
+            boost::this_thread::sleep(boost::posix_time::milliseconds(std::min(remaining, slice).count()));
+        }
+    }
+}
+
+namespace{
+    /**
+     * counts a request as outstanding on a node for the lifetime of the object and records its latency
+     * _refused is set if the limiter or the circuit breaker of the node did not admit the request, nothing is recorded then
+     */
+    struct accounting{
+        tash::node&                         _node;
+        tash::node::clock_type::time_point  _start;
+        bool                                _success;
+        bool                                _counted;
+        boost::system::error_code           _refused;
+        
+        explicit accounting(tash::node& n): _node(n), _start(tash::node::clock_type::now()), _success(false), _counted(true), _refused(n.begin()){}
+        ~accounting(){
+            if(!_refused){
+                _node.end(tash::node::clock_type::now() - _start, _success, _counted);
+            }
+        }
+    };
+}
+
+void tash::connection::connect(tash::node& target, tash::channel& ch, const tash::deadline& deadline){
+    boost::system::error_code ec = boost::asio::error::host_not_found;
+    for(const tash::dns_cache::endpoint_type& endpoint: target.dns().endpoints()){
+        ch.close();
+        tash::connect(ch.socket(), endpoint, deadline, ec);
+        if(!ec){
+            target.dns().prefer(endpoint);
+            tash::channel::no_delay(ch.socket());
+            if(boost::shared_ptr<tash::tls> settings = target.tls()){
+                ch.secure(settings);
+                tash::channel_stream stream(ch, deadline);
+                stream.handshake(*settings, ec);
+                if(ec){
+                    ch.close();
+                    throw boost::system::system_error(ec);
+                }
+            }
+            return;
+        }
+        if(deadline.check(deadline.total())){
+            // the request ran out of time or was cancelled, that says nothing about the address
+            throw boost::system::system_error(ec);
+        }
+        target.dns().failed(endpoint);
+    }
+    // none of the cached addresses accepted the connection, so they may be outdated
+    target.dns().invalidate();
+    throw boost::system::system_error(ec);
+}
+
+namespace{
+    /**
+     * asynchronous connect, write and read of a single request over a pooled channel
+     * a coordinator that cannot be connected to is quarantined and, unless the request is pinned to it, another one is tried
+     * the steps run on a strand shared with the deadline timer and the cancellation, either of which closes the socket to abort the step in flight
+     * transient failures are retried after a pause on the same timer as far as the retry policy, the budget and idempotency allow
+     */
+    class exchange_op: public std::enable_shared_from_this<exchange_op>{
+        typedef std::function<void(boost::system::error_code, tash::http_response_type, tash::node_ptr)> handler_type;
+        
+        tash::balancer&                 _balancer;
+        tash::node_ptr                  _node;
+        bool                            _pinned;
+        std::vector<tash::node_ptr>     _tried;
+        std::unique_ptr<accounting>     _accounting;
+        tash::pool::channel_ptr         _channel;
+        boost::shared_ptr<tash::multiplexer> _stream;
+        std::uint64_t                   _message;
+        std::vector<tash::dns_cache::endpoint_type> _endpoints;
+        tash::http_request_type         _request;
+        boost::beast::flat_buffer       _buffer;
+        tash::http_response_type        _response;
+        boost::optional<boost::beast::http::response_parser<boost::beast::http::dynamic_body>> _parser;
+        handler_type                    _handler;
+        bool                            _reused;
+        tash::deadline                  _deadline;
+        boost::asio::strand<boost::asio::io_context::executor_type> _strand;
+        boost::asio::steady_timer       _timer;
+        bool                            _connecting;
+        bool                            _connect_expired;
+        bool                            _resolving;
+        std::size_t                     _resolution;
+        boost::system::error_code       _aborted;
+        std::size_t                     _subscription;
+        bool                            _done;
+        tash::retry_policy              _policy;
+        tash::retry_budget&             _budget;
+        bool                            _idempotent;
+        bool                            _sent;
+        std::size_t                     _attempt;
+      public:
+        exchange_op(boost::asio::io_context& io, tash::balancer& balancer, tash::node_ptr target, const tash::http_request_type& request, const tash::request_options& options, const tash::retry_policy& policy, tash::retry_budget& budget, handler_type handler)
+            : _balancer(balancer), _node(target), _pinned(static_cast<bool>(target)), _message(0), _request(request), _handler(handler), _reused(false),
+              _deadline(options), _strand(io.get_executor()), _timer(io), _connecting(false), _connect_expired(false), _resolving(false), _resolution(0), _subscription(0), _done(false),
+              _policy(policy), _budget(budget), _idempotent(options.idempotent.value_or(tash::idempotent(request.method()))), _sent(false), _attempt(1){}
+        void launch(){
+            auto self = shared_from_this();
+            if(const tash::cancellation* token = _deadline.token()){
+                _subscription = token->subscribe([self](){
+                    boost::asio::post(self->_strand, [self](){
+                        self->abort(boost::asio::error::operation_aborted);
+                    });
+                });
+            }
+            boost::asio::dispatch(_strand, [self](){
+                self->start();
+            });
+        }
+      private:
+        void start(){
+            if(_done){
+                return;
+            }
+            if(boost::system::error_code ec = _deadline.check(_deadline.total())){
+                return finish(ec);
+            }
+            if(!_pinned){
+                _node = _balancer.pick(_tried);
+            }
+            _accounting.reset(new accounting(*_node));
+            if(_accounting->_refused){
+                boost::system::error_code ec = _accounting->_refused;
+                _accounting.reset();
+                return refused(ec);
+            }
+            arm(_deadline.total());
+            _stream = _node->stream();
+            if(_stream){
+                auto self = shared_from_this();
+                _message = _stream->start(_request, _deadline, [self](boost::system::error_code ec, tash::http_response_type response, bool delivered){
+                    boost::asio::post(self->_strand, [self, ec, response = std::move(response), delivered]() mutable{
+                        if(self->_done){
+                            return;
+                        }
+                        if(ec && !delivered){
+                            return self->unreachable(ec);
+                        }
+                        self->_sent = true;
+                        self->_response = std::move(response);
+                        self->finish(ec);
+                    });
+                });
+                return;
+            }
+            _channel = _node->pool().acquire();
+            _reused  = _channel->is_open();
+            if(_reused){
+                write();
+            }else{
+                connect();
+            }
+        }
+        /**
+         * limits the step that is about to start, the total deadline alone if the limit is later
+         */
+        void arm(tash::deadline::clock_type::time_point limit){
+            if(limit == tash::deadline::clock_type::time_point::max()){
+                _timer.cancel();
+                return;
+            }
+            _timer.expires_at(limit);
+            auto self = shared_from_this();
+            _timer.async_wait(boost::asio::bind_executor(_strand, [self](boost::system::error_code ec){
+                if(ec || self->_done || self->_timer.expiry() > tash::deadline::clock_type::now()){
+                    // cancelled or rearmed for a later step
+                    return;
+                }
+                self->expired();
+            }));
+        }
+        void expired(){
+            if(_connecting && _timer.expiry() < _deadline.total()){
+                // only the connect timeout passed, the request may still go to another coordinator
+                if(_resolving){
+                    _resolving  = false;
+                    _connecting = false;
+                    return unreachable(boost::asio::error::timed_out);
+                }
+                _connect_expired = true;
+                boost::system::error_code ignored;
+                _channel->socket().close(ignored);
+                return;
+            }
+            abort(boost::asio::error::timed_out);
+        }
+        void abort(const boost::system::error_code& ec){
+            if(_done || _aborted){
+                return;
+            }
+            _aborted = ec;
+            if(_stream){
+                _stream->abandon(_message);
+                return finish(ec);
+            }
+            if(_resolving){
+                // nothing to close while the host is resolved, the resolution is ignored when it completes
+                _resolving = false;
+                return finish(ec);
+            }
+            if(_channel){
+                // the step in flight completes with operation_aborted and then reports _aborted
+                boost::system::error_code ignored;
+                _channel->socket().close(ignored);
+                return;
+            }
+            finish(ec);
+        }
+        void connect(){
+            // the connect timeout covers the resolution, which only has to be waited for when nothing is cached for the host
+            _connecting = true;
+            _resolving  = true;
+            arm(_deadline.phase(_deadline.timeouts().connect));
+            auto self = shared_from_this();
+            std::size_t resolution = ++_resolution;
+            _node->dns().async_endpoints([self, resolution](boost::system::error_code ec, std::vector<tash::dns_cache::endpoint_type> endpoints){
+                boost::asio::dispatch(self->_strand, [self, resolution, ec, endpoints = std::move(endpoints)]() mutable{
+                    if(self->_done || !self->_resolving || resolution != self->_resolution){
+                        // aborted or timed out while resolving
+                        return;
+                    }
+                    self->_resolving = false;
+                    if(ec){
+                        self->_connecting = false;
+                        return self->unreachable(ec);
+                    }
+                    self->_endpoints = std::move(endpoints);
+                    self->dial();
+                });
+            });
+        }
+        void dial(){
+            auto self = shared_from_this();
+            boost::asio::async_connect(_channel->socket(), _endpoints, boost::asio::bind_executor(_strand, [self](boost::system::error_code ec, const tash::dns_cache::endpoint_type& endpoint){
+                self->_connecting = false;
+                if(ec){
+                    if(self->_connect_expired){
+                        self->_connect_expired = false;
+                        ec = boost::asio::error::timed_out;
+                    }
+                    self->_node->dns().invalidate();
+                    return self->unreachable(ec);
+                }
+                self->_node->dns().prefer(endpoint);
+                tash::channel::no_delay(self->_channel->socket());
+                if(boost::shared_ptr<tash::tls> settings = self->_node->tls()){
+                    return self->handshake(settings);
+                }
+                self->write();
+            }));
+        }
+        void handshake(boost::shared_ptr<tash::tls> settings){
+            // the handshake is part of connecting, if it fails or times out another coordinator may take the request
+            _connecting = true;
+            auto self = shared_from_this();
+            _channel->secure(settings).async_handshake(boost::asio::ssl::stream_base::client, boost::asio::bind_executor(_strand, [self, settings](boost::system::error_code ec){
+                self->_connecting = false;
+                settings->handshaked(*self->_channel->tls(), ec);
+                if(ec){
+                    if(self->_connect_expired){
+                        self->_connect_expired = false;
+                        ec = boost::asio::error::timed_out;
+                    }
+                    self->_channel->close();
+                    return self->unreachable(ec);
+                }
+                self->write();
+            }));
+        }
+        void refused(const boost::system::error_code& ec){
+            // the coordinator is saturated or failing, another one may take the request
+            if(!_pinned){
+                _tried.push_back(_node);
+                if(_balancer.pick(_tried)){
+                    return start();
+                }
+            }
+            finish(ec);
+        }
+        void unreachable(const boost::system::error_code& ec){
+            if(_aborted){
+                return finish(_aborted);
+            }
+            // nothing has been sent yet, so another coordinator can take the request
+            _node->quarantine(_balancer.quarantine());
+            if(!_pinned){
+                _tried.push_back(_node);
+                if(_balancer.pick(_tried)){
+                    _channel.reset();
+                    _accounting.reset();
+                    return start();
+                }
+            }
+            finish(ec);
+        }
+        void write(){
+            _sent = true;
+            arm(_deadline.phase(_deadline.timeouts().write));
+            if(tash::tls_stream* secure = _channel->tls()){
+                return write(*secure);
+            }
+            write(_channel->socket());
+        }
+        template <typename StreamT>
+        void write(StreamT& stream){
+            auto self = shared_from_this();
+            boost::beast::http::async_write(stream, _request, boost::asio::bind_executor(_strand, [self](boost::system::error_code ec, std::size_t){
+                if(ec){
+                    return self->failed(ec);
+                }
+                self->read();
+            }));
+        }
+        void read(){
+            // the response head stands in for the first byte
+            arm(_deadline.phase(_deadline.timeouts().first_byte));
+            _parser.emplace();
+            if(tash::tls_stream* secure = _channel->tls()){
+                return read(*secure);
+            }
+            read(_channel->socket());
+        }
+        template <typename StreamT>
+        void read(StreamT& stream){
+            auto self = shared_from_this();
+            StreamT* s = &stream;
+            boost::beast::http::async_read_header(stream, _buffer, *_parser, boost::asio::bind_executor(_strand, [self, s](boost::system::error_code ec, std::size_t){
+                if(ec){
+                    return self->failed(ec);
+                }
+                self->arm(self->_deadline.total());
+                boost::beast::http::async_read(*s, self->_buffer, *self->_parser, boost::asio::bind_executor(self->_strand, [self](boost::system::error_code ec, std::size_t){
+                    if(ec){
+                        return self->failed(ec);
+                    }
+                    self->_response = self->_parser->release();
+                    self->finish(ec);
+                }));
+            }));
+        }
+        void failed(const boost::system::error_code& ec){
+            if(_aborted){
+                return finish(_aborted);
+            }
+            if(_reused && tash::channel::stale(ec) && _buffer.size() == 0){
+                _reused = false;
+                _channel->close();
+                _node->pool().reconnected();
+                _response = tash::http_response_type();
+                return connect();
+            }
+            finish(ec);
+        }
+        /**
+         * schedules another attempt if the failure is transient and retrying is allowed
+         */
+        bool retry(const boost::system::error_code& ec){
+            std::chrono::milliseconds pause(0);
+            const bool transient = ec ? tash::transient(ec) : tash::transient(_response);
+            if(_aborted || !transient || (_sent && !_idempotent) || !again(_policy, _budget, _attempt, _deadline, pause)){
+                return false;
+            }
+            if(!ec){
+                // the coordinator cannot serve requests right now, the next attempt prefers another one
+                _node->quarantine(_balancer.quarantine());
+            }
+            if(_channel){
+                _channel->close();
+                _channel.reset();
+            }
+            _stream.reset();
+            _accounting.reset();
+            _tried.clear();
+            _sent     = false;
+            _reused   = false;
+            _response = tash::http_response_type();
+            _buffer.consume(_buffer.size());
+            ++_attempt;
+            _timer.expires_after(pause);
+            auto self = shared_from_this();
+            _timer.async_wait(boost::asio::bind_executor(_strand, [self](boost::system::error_code ec){
+                if(ec || self->_done){
+                    return;
+                }
+                self->start();
+            }));
+            return true;
+        }
+        void finish(boost::system::error_code ec){
+            if(_done || retry(ec)){
+                return;
+            }
+            _done = true;
+            _timer.cancel();
+            if(_accounting && ec == boost::asio::error::operation_aborted){
+                // a request cancelled by the caller says nothing about the coordinator
+                _accounting->_counted = false;
+            }
+            if(const tash::cancellation* token = _deadline.token()){
+                token->unsubscribe(_subscription);
+            }
+            if(ec){
+                if(_channel){
+                    _channel->close();
+                }
+            }else{
+                _accounting->_success = !tash::transient(_response);
+                if(_accounting->_success){
+                    _budget.deposit();
+                }
+                if(_channel){
+                    _channel->touch();
+                    if(_response.keep_alive()){
+                        _node->pool().release(std::move(_channel));
+                    }
+                }
+                try{
+                    tash::decode(_response);
+                }catch(const std::exception&){
+                    ec = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+                }
+            }
+            _accounting.reset();
+            _handler(ec, std::move(_response), _node);
+        }
+    };
+}
+
+void tash::connection::start_query(const tash::http_request_type& request, std::function<void(boost::system::error_code, tash::http_response_type)> handler){
+    start_query(request, tash::node_ptr(), [handler](boost::system::error_code ec, tash::http_response_type response, tash::node_ptr){
+        handler(ec, std::move(response));
+    });
+}
+
+void tash::connection::start_query(const tash::http_request_type& request, tash::node_ptr target, std::function<void(boost::system::error_code, tash::http_response_type, tash::node_ptr)> handler){
+    start_query(request, target, tash::request_options(_timeouts), handler);
+}
+
+void tash::connection::start_query(const tash::http_request_type& request, tash::node_ptr target, const tash::request_options& options, std::function<void(boost::system::error_code, tash::http_response_type, tash::node_ptr)> handler){
+    if(!_bearer){
+        return std::make_shared<exchange_op>(_io, _balancer, target, request, options, _retry, _budget, handler)->launch();
+    }
+    std::make_shared<exchange_op>(_io, _balancer, target, request, options, _retry, _budget, [this, request, target, options, handler](boost::system::error_code ec, tash::http_response_type response, tash::node_ptr n){
+        if(ec || response.result() != http::status::unauthorized){
+            return handler(ec, std::move(response), n);
+        }
+        // the token expired early, the request is sent once more with a fresh one
+        auto replay = [this, request, target, options, handler](){
+            tash::http_request_type renewed(request);
+            renewed.set(http::field::authorization, authorization());
+            std::make_shared<exchange_op>(_io, _balancer, target, renewed, options, _retry, _budget, handler)->launch();
+        };
+        if(authorization() != request[http::field::authorization]){
+            return replay();
+        }
+        // the login runs asynchronously as well, blocking here would stall the io threads
+        auto rejected = std::make_shared<tash::http_response_type>(std::move(response));
+        {
+            boost::mutex::scoped_lock lock(_relogin_mutex);
+            _relogins.push_back([replay, handler, rejected, n](bool renewed){
+                if(renewed){
+                    return replay();
+                }
+                handler(boost::system::error_code(), std::move(*rejected), n);
+            });
+            if(_relogins.size() > 1){
+                // another rejected request started the login already
+                return;
+            }
+        }
+        std::make_shared<exchange_op>(_io, _balancer, target, credentials(), options, _retry, _budget, [this](boost::system::error_code ec, tash::http_response_type response, tash::node_ptr){
+            bool renewed = false;
+            if(!ec){
+                try{
+                    renewed = renew(response);
+                }catch(const std::exception&){
+                    // e.g. a proxy answered with a page that is not JSON, the rejected requests fail with their 401
+                }
+            }
+            std::vector<std::function<void(bool)>> waiting;
+            {
+                boost::mutex::scoped_lock lock(_relogin_mutex);
+                waiting.swap(_relogins);
+            }
+            for(const std::function<void(bool)>& resume: waiting){
+                resume(renewed);
+            }
+        })->launch();
+    })->launch();
+}
+
+tash::pool::channel_ptr tash::connection::checkout(tash::node& target, bool& reused, const tash::deadline& deadline){
+    tash::pool::channel_ptr ch = target.pool().acquire();
+    reused = ch->is_open();
+    if(!reused){
+        connect(target, *ch, deadline);
+    }
+    return ch;
+}
+
+template <typename MessageT>
+tash::http_response_type tash::connection::transfer(tash::node& target, tash::pool::channel_ptr ch, bool reused, const MessageT& request, const tash::deadline& deadline){
+    // the read buffer keeps its capacity across the requests made by a thread
+    static thread_local boost::beast::flat_buffer buffer;
+    buffer.consume(buffer.size());
+    boost::system::error_code ec;
     tash::http_response_type res;
-    boost::beast::http::read(socket, buffer, res);
+    exchange(*ch, request, buffer, res, deadline, ec);
+    if(ec && reused && tash::channel::stale(ec) && buffer.size() == 0){
+        // the server closed the idle socket before any response arrived, so the request is replayed once on a fresh socket
+        ch->close();
+        target.pool().reconnected();
+        try{
+            connect(target, *ch, deadline);
+        }catch(const boost::system::system_error&){
+            ch->close();
+            throw;
+        }
+        res = tash::http_response_type();
+        exchange(*ch, request, buffer, res, deadline, ec);
+    }
+    if(ec){
+        ch->close();
+        throw boost::system::system_error(ec);
+    }
+    ch->touch();
+    if(res.keep_alive()){
+        target.pool().release(std::move(ch));
+    }
+    tash::decode(res);
     return res;
 }
 
-tash::http_response_type tash::connection::query(std::string path, boost::beast::http::verb method){
-    tash::http_request_type request;
-    if(boost::algorithm::starts_with(path, "/")){
-        request = url(method, path);
-    }else{
-        request = db_url(method, path);
+template <typename MessageT>
+tash::http_response_type tash::connection::transmit(const MessageT& request, tash::node_ptr& target, const tash::deadline& deadline, bool& sent){
+    const bool pinned = static_cast<bool>(target);
+    std::vector<tash::node_ptr> tried;
+    while(true){
+        if(!pinned){
+            target = _balancer.pick(tried);
+        }
+        // no lock is held while the request is in flight, every thread checks out a channel of its own from the pool
+        boost::shared_ptr<tash::multiplexer> stream = target->stream();
+        accounting account(*target);
+        if(account._refused){
+            // the coordinator is saturated or failing, another one may take the request
+            tried.push_back(target);
+            if(pinned || !_balancer.pick(tried)){
+                throw boost::system::system_error(account._refused);
+            }
+            continue;
+        }
+        bool reused = false;
+        tash::pool::channel_ptr ch;
+        try{
+            if(stream){
+                stream->connect(deadline);
+            }else{
+                ch = checkout(*target, reused, deadline);
+            }
+        }catch(const boost::system::system_error& error){
+            account._counted = error.code() != boost::asio::error::operation_aborted;
+            if(deadline.check(deadline.total())){
+                // out of time or cancelled, trying another coordinator would not help
+                throw;
+            }
+            // nothing has been sent yet, so another coordinator can take the request
+            target->quarantine(_balancer.quarantine());
+            tried.push_back(target);
+            if(pinned || !_balancer.pick(tried)){
+                throw;
+            }
+            continue;
+        }
+        sent = true;
+        try{
+            tash::http_response_type res = stream ? over_stream(*stream, request, deadline) : transfer(*target, std::move(ch), reused, request, deadline);
+            account._success = !tash::transient(res);
+            return res;
+        }catch(const boost::system::system_error& error){
+            // a request cancelled by the caller says nothing about the coordinator
+            account._counted = error.code() != boost::asio::error::operation_aborted;
+            throw;
+        }
+    }
+}
+
+template <typename MessageT>
+tash::http_response_type tash::connection::deliver(const MessageT& request, tash::node_ptr& target, const tash::request_options& options, bool idempotent){
+    const tash::deadline deadline(options);
+    const bool pinned = static_cast<bool>(target);
+    std::chrono::milliseconds pause(0);
+    for(std::size_t attempt = 1; ; ++attempt){
+        if(attempt > 1){
+            if(boost::system::error_code ec = pace(pause, deadline)){
+                throw boost::system::system_error(ec);
+            }
+            if(!pinned){
+                target.reset();
+            }
+        }
+        bool sent = false;
+        try{
+            tash::http_response_type res = transmit(request, target, deadline, sent);
+            if(!tash::transient(res)){
+                _budget.deposit();
+                return res;
+            }
+            if(!idempotent || !again(_retry, _budget, attempt, deadline, pause)){
+                return res;
+            }
+            // the coordinator cannot serve requests right now, the next attempt prefers another one
+            target->quarantine(_balancer.quarantine());
+        }catch(const boost::system::system_error& error){
+            if((sent && !idempotent) || !tash::transient(error.code()) || !again(_retry, _budget, attempt, deadline, pause)){
+                throw;
+            }
+        }
+    }
+}
+
+tash::http_response_type tash::connection::query(const tash::http_request_type& request){
+    tash::node_ptr target;
+    return query(request, target, tash::request_options(_timeouts));
+}
+
+tash::http_response_type tash::connection::query(const tash::http_request_type& request, tash::node_ptr& target){
+    return query(request, target, tash::request_options(_timeouts));
+}
+
+tash::http_response_type tash::connection::query(const tash::http_request_type& request, const tash::request_options& options){
+    tash::node_ptr target;
+    return query(request, target, options);
+}
+
+tash::http_response_type tash::connection::query(const tash::http_request_type& request, tash::node_ptr& target, const tash::request_options& options){
+    const bool idempotent = options.idempotent.value_or(tash::idempotent(request.method()));
+    tash::http_response_type response = deliver(request, target, options, idempotent);
+    if(response.result() == http::status::unauthorized && reauthenticate(request[http::field::authorization])){
+        // the token expired early, e.g. because the server restarted, the request is sent once more with a fresh one
+        tash::http_request_type renewed(request);
+        renewed.set(http::field::authorization, authorization());
+        return deliver(renewed, target, options, idempotent);
+    }
+    return response;
+}
+
+tash::http_response_type tash::connection::send(boost::beast::http::verb method, std::initializer_list<boost::beast::string_view> path, boost::beast::string_view content, boost::beast::string_view type){
+    if(_primary->stream()){
+        // VelocyStream and HTTP/2 have their own framing, the HTTP/1.1 head is not needed
+        std::string joined;
+        for(const boost::beast::string_view& segment: path){
+            joined.append(segment.data(), segment.size());
+        }
+        return query(request(joined, std::string(content), std::string(type), method));
+    }
+    static thread_local std::string head;
+    static thread_local std::string encoded;
+    boost::beast::string_view verb = boost::beast::http::to_string(method);
+    for(bool renewed = false; ; renewed = true){
+        boost::shared_ptr<const std::string> authorization = boost::atomic_load(&_authorization);
+        boost::shared_ptr<const std::string> preamble      = boost::atomic_load(&_preamble);
+        boost::beast::string_view body = content;
+        head.clear();
+        head.append(verb.data(), verb.size()).append(" ");
+        if(path.size() == 0 || !boost::algorithm::starts_with(*path.begin(), "/")){
+            head.append(_prefix);
+        }
+        for(const boost::beast::string_view& segment: path){
+            head.append(segment.data(), segment.size());
+        }
+        head.append(" HTTP/1.1\r\n").append(*preamble);
+        if(_compression.threshold > 0 && body.size() >= _compression.threshold){
+            encoded = tash::gzip(body, _compression.level);
+            body = encoded;
+            head.append("Content-Encoding: gzip\r\n");
+        }
+        if(!body.empty() || method == boost::beast::http::verb::post || method == boost::beast::http::verb::put || method == boost::beast::http::verb::patch){
+            char length[24];
+            int digits = std::snprintf(length, sizeof(length), "%zu", body.size());
+            head.append("Content-Type: ").append(type.data(), type.size()).append("\r\nContent-Length: ").append(length, digits).append("\r\n");
+        }
+        head.append("\r\n");
+        wire_type wire{{boost::asio::buffer(head), boost::asio::buffer(body.data(), body.size())}};
+        tash::node_ptr target;
+        tash::http_response_type response = deliver(wire, target, tash::request_options(_timeouts), tash::idempotent(method));
+        if(renewed || response.result() != http::status::unauthorized || !reauthenticate(*authorization)){
+            return response;
+        }
+    }
+}
+
+std::size_t tash::connection::discover(){
+    tash::http_response_type response = query(url(boost::beast::http::verb::get, "/_api/cluster/endpoints"));
+    if(response.result() == http::status::ok){
+        nlohmann::json json = parse(response);
+        for(const nlohmann::json& entry: json.value("endpoints", nlohmann::json::array())){
+            try{
+                tash::endpoint ep = tash::endpoint::parse(entry.value("endpoint", std::string()));
+                if(ep.local() && !_primary->endpoint().local()){
+                    // a unix domain socket is only reachable on the host of the coordinator
+                    continue;
+                }
+                if(ep._scheme == "tcp" && _primary->stream()){
+                    // coordinators serve VelocyStream and HTTP/2 on their HTTP endpoints
+                    ep._scheme = _primary->endpoint().scheme();
+                }
+                join(ep);
+            }catch(const std::invalid_argument&){
+                // endpoints with a transport that is not supported are skipped
+            }
+        }
     }
-    return query(request);
+    return _balancer.nodes().size();
 }
 
-tash::http_response_type tash::connection::query(std::string path, const std::string& content, std::string type, boost::beast::http::verb method){
-    tash::http_request_type request;
+void tash::connection::probe(){
+    probe(tash::request_options(tash::timeouts(std::chrono::seconds(5))));
+}
+void tash::connection::probe(const tash::request_options& options){
+    for(const tash::node_ptr& n: _balancer.nodes()){
+        tash::node_ptr target = n;
+        try{
+            tash::http_response_type response = query(url(boost::beast::http::verb::get, "/_api/version"), target, options);
+            n->healthy(response.result() != http::status::service_unavailable);
+        }catch(const std::exception&){
+            if(options.token && options.token->cancelled()){
+                // stopped, not a verdict on the coordinator
+                return;
+            }
+            n->healthy(false);
+        }
+    }
+}
+
+void tash::connection::health_checks(std::chrono::milliseconds interval){
+    if(_health.joinable()){
+        // a probe in flight is no interruption point, it is aborted through the token
+        _health_token.cancel();
+        _health.interrupt();
+        _health.join();
+    }
+    if(interval.count() <= 0){
+        return;
+    }
+    _health_token = tash::cancellation();
+    _health = boost::thread([this, interval](){
+        tash::request_options options(tash::timeouts(std::min<std::chrono::milliseconds>(interval, std::chrono::seconds(5))), _health_token);
+        try{
+            while(true){
+                probe(options);
+                boost::this_thread::sleep(boost::posix_time::milliseconds(interval.count()));
+            }
+        }catch(const boost::thread_interrupted&){}
+    });
+}
+
+tash::http_request_type tash::connection::request(std::string path, boost::beast::http::verb method) const{
     if(boost::algorithm::starts_with(path, "/")){
-        request = url(method, path);
-    }else{
-        request = db_url(method, path);
+        return url(method, path);
     }
-    request.set(boost::beast::http::field::content_type, type);
-    request.set(boost::beast::http::field::content_length, std::to_string(content.size()));
-    request.body() = content;
-    return query(request);
+    return db_url(method, path);
 }
 
-tash::cursor tash::connection::aql(const std::string& q, int count, int batch){
-    nlohmann::json document{
-        {"query", q}
-    };
-    if(count != 0){
-        document["count"] = count;
+tash::http_request_type tash::connection::request(std::string path, std::string content, std::string type, boost::beast::http::verb method) const{
+    tash::http_request_type req = request(std::move(path), method);
+    req.set(boost::beast::http::field::content_type, type);
+    if(_compression.threshold > 0 && content.size() >= _compression.threshold){
+        content = tash::gzip(content, _compression.level);
+        req.set(boost::beast::http::field::content_encoding, "gzip");
     }
-    if(batch != 0){
-        document["batchSize"] = batch;
+    req.set(boost::beast::http::field::content_length, std::to_string(content.size()));
+    req.body() = std::move(content);
+    return req;
+}
+
+tash::http_response_type tash::connection::query(std::string path, boost::beast::http::verb method){
+    return query(request(std::move(path), method));
+}
+
+tash::http_response_type tash::connection::query(std::string path, std::string content, std::string type, boost::beast::http::verb method){
+    return query(request(std::move(path), std::move(content), std::move(type), method));
+}
+
+namespace{
+    nlohmann::json aql_document(const std::string& q, int count, int batch, bool retry){
+        nlohmann::json document{
+            {"query", q}
+        };
+        if(count != 0){
+            document["count"] = count;
+        }
+        if(batch != 0){
+            document["batchSize"] = batch;
+        }
+        if(retry){
+            // the server then hands out batch ids and keeps the last batch, so a fetch whose response got lost can be repeated
+            document["options"] = nlohmann::json{{"allowRetry", true}};
+        }
+        return document;
     }
-    tash::http_response_type response = query("_api/cursor", document.dump(), "application/json", boost::beast::http::verb::post);
+}
+
+tash::http_request_type tash::connection::aql_request(const std::string& q, int count, int batch) const{
+    return request("_api/cursor", serialize(aql_document(q, count, batch, _retry.attempts > 1)), content_type(), boost::beast::http::verb::post);
+}
+
+tash::cursor tash::connection::aql(const std::string& q, int count, int batch){
+    tash::node_ptr target;
+    tash::http_response_type response = query(aql_request(q, count, batch), target);
+    return open(q, response, target);
+}
+
+tash::cursor tash::connection::aql(const std::string& q, tash::cursor::visitor_type visitor, int count, int batch){
+    tash::node_ptr target;
+    tash::http_response_type response = query(aql_request(q, count, batch), target);
+    return open(q, response, target, std::move(visitor));
+}
+
+tash::cursor tash::connection::open(const std::string& q, const tash::http_response_type& response, const tash::node_ptr& target, tash::cursor::visitor_type visitor){
     if(response.result() == http::status::ok || response.result() == http::status::accepted || response.result() == http::status::created){/* No Operation */}
     else{
         std::cout << "AQL Failed: " << q << std::endl;
@@ -108,51 +1236,440 @@ tash::cursor tash::connection::aql(const std::string& q, int count, int batch){
         std::cout << response << std::endl;
     }
     tash::cursor cursor(*this);
+    cursor._node    = target;
+    cursor._visitor = std::move(visitor);
     cursor.attach(response);
     return cursor;
 }
 
+void tash::connection::start_aql(const std::string& q, int count, int batch, std::function<void(boost::system::error_code, tash::cursor)> handler){
+    start_query(aql_request(q, count, batch), tash::node_ptr(), [this, q, handler](boost::system::error_code ec, tash::http_response_type response, tash::node_ptr target){
+        std::unique_ptr<tash::cursor> cursor;
+        if(!ec){
+            try{
+                cursor.reset(new tash::cursor(open(q, response, target)));
+            }catch(const std::exception&){
+                ec = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+            }
+        }
+        if(!cursor){
+            return handler(ec, tash::cursor(*this));
+        }
+        handler(ec, std::move(*cursor));
+    });
+}
+
 boost::beast::http::status tash::connection::exists() {
     return query("_api/version").result();
 }
 
-tash::cursor::cursor(tash::connection& conn, const std::string& id): _conn(conn), _id(id){}
-tash::cursor::cursor(tash::connection& conn): _conn(conn), _id(std::string()){}
-tash::cursor::cursor(const tash::cursor& other): _conn(other._conn), _id(other._id), _has_more(other._has_more), _error(other._error), _count(other._count), _code(other._code), _results(other._results){}
+tash::cursor::cursor(tash::connection& conn, const std::string& id): _conn(conn), _id(id), _has_more(false), _error(false), _count(0), _code(0){}
+tash::cursor::cursor(tash::connection& conn): _conn(conn), _id(std::string()), _has_more(false), _error(false), _count(0), _code(0){}
+tash::cursor::cursor(const tash::cursor& other): _conn(other._conn), _id(other._id), _has_more(other._has_more), _error(other._error), _count(other._count), _code(other._code), _results(other._results), _node(other._node), _batch(other._batch), _prefetcher(other._prefetcher), _visitor(other._visitor){}
+tash::cursor::cursor(tash::cursor&& other): _conn(other._conn), _has_more(false), _error(false), _count(0), _code(0){
+    boost::mutex::scoped_lock lock(other._mutex);
+    _id         = std::move(other._id);
+    _has_more   = other._has_more;
+    _error      = other._error;
+    _count      = other._count;
+    _code       = other._code;
+    _results    = std::move(other._results);
+    _node       = std::move(other._node);
+    _batch      = std::move(other._batch);
+    _prefetcher = std::move(other._prefetcher);
+    _visitor    = std::move(other._visitor);
+    other._has_more = false;
+}
 tash::cursor::~cursor(){
      boost::mutex::scoped_lock lock(_mutex);
 }
 
 nlohmann::json tash::cursor::results() const{
+    boost::shared_ptr<const nlohmann::json> batch = snapshot();
+    return batch ? *batch : nlohmann::json();
+}
+
+boost::shared_ptr<const nlohmann::json> tash::cursor::snapshot() const{
     boost::mutex::scoped_lock lock(_mutex);
     return _results;
 }
 
+nlohmann::json tash::cursor::take_results(){
+    boost::shared_ptr<nlohmann::json> batch = boost::make_shared<nlohmann::json>(nlohmann::json::array());
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        batch.swap(_results);
+    }
+    if(!batch){
+        return nlohmann::json();
+    }
+    if(batch.unique()){
+        // nobody else can get hold of the batch any more
+        return std::move(*batch);
+    }
+    return *batch;
+}
+
+const nlohmann::json& tash::cursor::current() const{
+    static const nlohmann::json none;
+    return _results ? *_results : none;
+}
+
+
+tash::http_request_type tash::cursor::next() const{
+    if(_batch.empty()){
+        // https://github.com/boostorg/beast/issues/819
+        return _conn.request("_api/cursor/"+_id, "", "application/json", boost::beast::http::verb::put);
+    }
+    return _conn.request("_api/cursor/"+_id+"/"+_batch, "", "application/json", boost::beast::http::verb::post);
+}
+
+tash::request_options tash::cursor::next_options() const{
+    tash::request_options options(_conn.timeouts());
+    // a batch addressed by its id can be fetched again, advancing the cursor cannot
+    options.idempotent = !_batch.empty();
+    return options;
+}
+
+/**
+ * fetches the batches of a cursor ahead on a thread of its own, a private copy of the cursor advances while the batches queue up
+ */
+class tash::cursor::prefetcher{
+  public:
+    struct batch{
+        boost::shared_ptr<nlohmann::json> _results;
+        bool                _has_more;
+        bool                _error;
+        int                 _count;
+        int                 _code;
+        std::string         _id;
+        std::string         _next;
+        tash::node_ptr      _node;
+        std::exception_ptr  _failure;
+        /**
+         * whether the documents went to a visitor while the batch was parsed
+         */
+        bool                _visited = false;
+    };
+    typedef std::function<void(batch)> handler_type;
+  private:
+    boost::mutex                _mutex;
+    boost::condition_variable   _ready;
+    tash::cursor                _ahead;
+    std::size_t                 _depth;
+    std::deque<batch>           _batches;
+    handler_type                _waiting;
+    /**
+     * the failure that ended the prefetching, every take() after the last batch rethrows it
+     */
+    std::exception_ptr          _failure;
+    /**
+     * the visitor of the cursor, _ahead takes it over before each fetch
+     */
+    tash::cursor::visitor_type  _visitor;
+    tash::cancellation          _cancel;
+    boost::thread               _thread;
+  public:
+    prefetcher(const tash::cursor& c, std::size_t depth): _ahead(c), _depth(depth), _visitor(c._visitor){
+        // the copy would keep the current batch of the cursor shared
+        _ahead._results.reset();
+        _thread = boost::thread([this](){
+            run();
+        });
+    }
+    ~prefetcher(){
+        // the request in flight is no interruption point, it is aborted through the token
+        _cancel.cancel();
+        _thread.interrupt();
+        _thread.join();
+    }
+    void depth(std::size_t depth){
+        boost::mutex::scoped_lock lock(_mutex);
+        _depth = depth;
+        _ready.notify_all();
+    }
+    void visit(tash::cursor::visitor_type visitor){
+        boost::mutex::scoped_lock lock(_mutex);
+        _visitor = std::move(visitor);
+    }
+    batch take(){
+        boost::mutex::scoped_lock lock(_mutex);
+        while(_batches.empty() && !_failure){
+            _ready.wait(lock);
+        }
+        if(_batches.empty()){
+            return failed();
+        }
+        batch b = std::move(_batches.front());
+        _batches.pop_front();
+        _ready.notify_all();
+        return b;
+    }
+    /**
+     * makes the batch the current one of the cursor, rethrows the failure of a fetch
+     * a batch fetched ahead before the cursor got its visitor is handed to the visitor now
+     */
+    static void adopt(tash::cursor& c, batch b){
+        if(b._failure){
+            std::rethrow_exception(b._failure);
+        }
+        if(c._visitor && !b._visited && b._results && b._results->is_array()){
+            for(nlohmann::json& document: *b._results){
+                c._visitor(document);
+            }
+            b._results = boost::make_shared<nlohmann::json>(nlohmann::json::array());
+        }
+        boost::mutex::scoped_lock lock(c._mutex);
+        c._results  = std::move(b._results);
+        c._has_more = b._has_more;
+        c._error    = b._error;
+        c._count    = b._count;
+        c._code     = b._code;
+        c._id       = b._id;
+        c._batch    = b._next;
+        c._node     = b._node;
+    }
+    /**
+     * calls the handler on the io_context of the connection once the next batch is there
+     */
+    void take(handler_type handler){
+        boost::mutex::scoped_lock lock(_mutex);
+        if(_batches.empty() && !_failure){
+            _waiting = std::move(handler);
+            return;
+        }
+        std::shared_ptr<batch> b;
+        if(_batches.empty()){
+            b = std::make_shared<batch>(failed());
+        }else{
+            b = std::make_shared<batch>(std::move(_batches.front()));
+            _batches.pop_front();
+        }
+        _ready.notify_all();
+        boost::asio::post(_ahead._conn.io(), [handler, b](){
+            handler(std::move(*b));
+        });
+    }
+  private:
+    void run(){
+        try{
+            bool more = true;
+            while(more){
+                {
+                    // the request in flight counts against the depth as well
+                    boost::mutex::scoped_lock lock(_mutex);
+                    while(_batches.size() >= _depth){
+                        _ready.wait(lock);
+                    }
+                    _ahead._visitor = _visitor;
+                }
+                tash::request_options options = _ahead.next_options();
+                options.token = _cancel;
+                tash::http_response_type response = _ahead._conn.query(_ahead.next(), _ahead._node, options);
+                _ahead.attach(response);
+                more = _ahead._has_more;
+                deliver(batch{std::move(_ahead._results), _ahead._has_more, _ahead._error, _ahead._count, _ahead._code, _ahead._id, _ahead._batch, _ahead._node, std::exception_ptr(), bool(_ahead._visitor)});
+            }
+        }catch(const boost::thread_interrupted&){
+            // the cursor is gone
+        }catch(...){
+            fail(std::current_exception());
+        }
+    }
+    batch failed() const{
+        batch b;
+        b._failure = _failure;
+        return b;
+    }
+    void fail(std::exception_ptr failure){
+        boost::mutex::scoped_lock lock(_mutex);
+        _failure = failure;
+        if(_waiting){
+            handler_type handler = std::move(_waiting);
+            _waiting = handler_type();
+            std::shared_ptr<batch> shared = std::make_shared<batch>(failed());
+            boost::asio::post(_ahead._conn.io(), [handler, shared](){
+                handler(std::move(*shared));
+            });
+            return;
+        }
+        _ready.notify_all();
+    }
+    void deliver(batch b){
+        boost::mutex::scoped_lock lock(_mutex);
+        if(_waiting){
+            handler_type handler = std::move(_waiting);
+            _waiting = handler_type();
+            std::shared_ptr<batch> shared = std::make_shared<batch>(std::move(b));
+            boost::asio::post(_ahead._conn.io(), [handler, shared](){
+                handler(std::move(*shared));
+            });
+            return;
+        }
+        _batches.push_back(std::move(b));
+        _ready.notify_all();
+    }
+};
+
+tash::cursor& tash::cursor::prefetch(std::size_t depth){
+    if(depth == 0){
+        throw std::invalid_argument("a cursor prefetches at least one batch");
+    }
+    if(_prefetcher){
+        _prefetcher->depth(depth);
+    }else if(_has_more){
+        _prefetcher = boost::make_shared<prefetcher>(*this, depth);
+    }
+    return *this;
+}
 
 void tash::cursor::fetch(){
-    // https://github.com/boostorg/beast/issues/819
-    tash::http_response_type response = _conn.query("_api/cursor/"+_id, "", "application/json", boost::beast::http::verb::put);
+    if(_prefetcher && _has_more){
+        return prefetcher::adopt(*this, _prefetcher->take());
+    }
+    tash::http_response_type response = _conn.query(next(), _node, next_options());
     attach(response);
 }
 
+void tash::cursor::start_fetch(std::function<void(boost::system::error_code)> handler){
+    if(_prefetcher && _has_more){
+        _prefetcher->take([this, handler](prefetcher::batch b){
+            boost::system::error_code ec;
+            try{
+                prefetcher::adopt(*this, std::move(b));
+            }catch(const boost::system::system_error& error){
+                ec = error.code();
+            }catch(const std::exception&){
+                ec = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+            }
+            handler(ec);
+        });
+        return;
+    }
+    _conn.start_query(next(), _node, next_options(), [this, handler](boost::system::error_code ec, tash::http_response_type response, tash::node_ptr target){
+        _node = target;
+        if(!ec){
+            try{
+                attach(response);
+            }catch(const std::exception&){
+                ec = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+            }
+        }
+        handler(ec);
+    });
+}
+
+tash::cursor& tash::cursor::visit(visitor_type visitor){
+    _visitor = std::move(visitor);
+    if(_prefetcher){
+        _prefetcher->visit(_visitor);
+    }
+    return *this;
+}
+
+namespace{
+    
+    /**
+     * element policy of cursor_sax that hands each element of "result" to the visitor once it is complete
+     */
+    class visiting_element{
+        const tash::cursor::visitor_type& _visitor;
+        nlohmann::json                    _document;
+        tash::detail::json_builder        _builder;
+      public:
+        explicit visiting_element(const tash::cursor::visitor_type& visitor): _visitor(visitor){}
+        template <typename V>
+        void value(V&& v){
+            if(_builder.building()){
+                _builder.value(nlohmann::json(std::move(v)));
+            }else{
+                // a scalar document
+                nlohmann::json document(std::move(v));
+                _visitor(document);
+            }
+        }
+        void key(nlohmann::json::string_t& k){
+            _builder.key(k);
+        }
+        bool start(nlohmann::json::value_t type){
+            if(_builder.building()){
+                _builder.start(type);
+            }else{
+                _builder.open(_document, type);
+            }
+            return true;
+        }
+        bool end(){
+            if(!_builder.building()){
+                // the end of "result"
+                return false;
+            }
+            if(_builder.end()){
+                _visitor(_document);
+                _document = nlohmann::json();
+            }
+            return true;
+        }
+    };
+    
+}
+
 void tash::cursor::attach(const tash::http_response_type& response){
+    nlohmann::json json;
+    if(_visitor && !boost::algorithm::istarts_with(response[boost::beast::http::field::content_type], "application/x-velocypack")){
+        visiting_element element(_visitor);
+        tash::detail::cursor_sax<visiting_element> reader(element);
+        tash::detail::body_streambuf buffer(response.body().data());
+        std::istream stream(&buffer);
+        nlohmann::json::sax_parse(stream, &reader);
+        json = std::move(reader.meta());
+        json["result"] = nlohmann::json::array();
+    }else{
+        json = tash::connection::parse(response);
+        if(_visitor && json.count("result") && json["result"].is_array()){
+            // VelocyPack is decoded as a whole, the documents are handed over one by one nonetheless
+            for(nlohmann::json& document: json["result"]){
+                _visitor(document);
+            }
+            json["result"] = nlohmann::json::array();
+        }
+    }
+    adopt(json);
+}
+
+void tash::cursor::adopt(nlohmann::json& json){
+    boost::shared_ptr<nlohmann::json> results = boost::make_shared<nlohmann::json>(std::move(json["result"]));
     boost::mutex::scoped_lock lock(_mutex);
-    nlohmann::json json = nlohmann::json::parse(boost::beast::buffers_to_string(response.body().data()));
     _has_more = json.value("hasMore", false);
     _error    = json.value("error",   false);
     _count    = json.value("count",   0);
     _code     = json.value("code",    0);
-    _results  = json["result"];
+    _results  = std::move(results);
     if(_id.empty()){
         _id = json.value("id", std::string());
     }
+    _batch.clear();
+    if(json.count("nextBatchId")){
+        const nlohmann::json& batch = json["nextBatchId"];
+        _batch = batch.is_string() ? batch.get<std::string>() : batch.dump();
+    }
 }
 
 tash::shell::shell(const std::string& db, std::string host, unsigned int port, std::string user, std::string pass): connection(db, host, port, user, pass){}
+tash::shell::shell(const std::string& db, const std::vector<std::string>& endpoints, std::string user, std::string pass): connection(db, endpoints, user, pass){}
+tash::shell::shell(boost::shared_ptr<tash::executor> executor, const std::string& db, std::string host, unsigned int port, std::string user, std::string pass): connection(executor, db, host, port, user, pass){}
+tash::shell::shell(boost::shared_ptr<tash::executor> executor, const std::string& db, const std::vector<std::string>& endpoints, std::string user, std::string pass): connection(executor, db, endpoints, user, pass){}
 tash::shell& tash::shell::operator>>(nlohmann::json& res){
-    res = results();
+    res = take_results();
     return *this;
 }
+boost::shared_ptr<tash::cursor> tash::shell::last() const{
+    boost::mutex::scoped_lock lock(_last_mutex);
+    if(!_last){
+        throw std::logic_error("shell has not run a query yet");
+    }
+    return _last;
+}
 
 
 tash::collection::collection(tash::connection& conn, const std::string& name, type t): _conn(conn), _name(name), _type(t){}
@@ -179,28 +1696,52 @@ boost::beast::http::status tash::collection::create(){
     return response.result();
 }
 
+tash::request_options tash::collection::insert_options(const nlohmann::json& document) const{
+    tash::request_options options(_conn.timeouts());
+    // a second insert of a document with a client supplied key cannot create a duplicate
+    options.idempotent = document.is_object() && document.count("_key") > 0;
+    return options;
+}
+
 boost::beast::http::status tash::collection::add(const nlohmann::json& document){
-    tash::http_response_type response = _conn.query("_api/document/"+_name, document.dump());
+    tash::http_response_type response = _conn.query(_conn.request("_api/document/"+_name, _conn.serialize(document), _conn.content_type()), insert_options(document));
     return response.result();
 }
 
 boost::beast::http::status tash::collection::add(nlohmann::json& document){
-    tash::http_response_type response = _conn.query("_api/document/"+_name, document.dump());
-    nlohmann::json json = nlohmann::json::parse(boost::beast::buffers_to_string(response.body().data()));
+    tash::http_response_type response = _conn.query(_conn.request("_api/document/"+_name, _conn.serialize(document), _conn.content_type()), insert_options(document));
+    nlohmann::json json = tash::connection::parse(response);
     document = json;
     return response.result();
 }
 
+void tash::collection::start_add(const nlohmann::json& document, nlohmann::json* target, std::function<void(boost::system::error_code, boost::beast::http::status)> handler){
+    _conn.async_query(_conn.request("_api/document/"+_name, _conn.serialize(document), _conn.content_type()), insert_options(document), [target, handler](boost::system::error_code ec, tash::http_response_type response){
+        if(!ec && target){
+            try{
+                *target = tash::connection::parse(response);
+            }catch(const std::exception&){
+                ec = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+            }
+        }
+        handler(ec, response.result());
+    });
+}
+
+std::string tash::collection::document_path(const std::string& key) const{
+    return (boost::format("_api/document/%1%/%2%") % _name % key).str();
+}
+
 tash::http_response_type tash::collection::update(const std::string key, const nlohmann::json& document){
-    return _conn.query((boost::format("_api/document/%1%/%2%") % _name % key).str(), document.dump(), "application/json", boost::beast::http::verb::patch);
+    return _conn.query(document_path(key), _conn.serialize(document), _conn.content_type(), boost::beast::http::verb::patch);
 }
 
 tash::http_response_type tash::collection::replace(const std::string key, const nlohmann::json& document){
-    return _conn.query((boost::format("_api/document/%1%/%2%") % _name % key).str(), document.dump(), "application/json", boost::beast::http::verb::put);
+    return _conn.query(document_path(key), _conn.serialize(document), _conn.content_type(), boost::beast::http::verb::put);
 }
 
 tash::http_response_type tash::collection::read(const std::string key){
-    return _conn.query((boost::format("_api/document/%1%/%2%") % _name % key).str());
+    return _conn.send(boost::beast::http::verb::get, {"_api/document/", _name, "/", key});
 }
 
 tash::http_response_type tash::collection::read(int limit, int skip){
@@ -235,14 +1776,31 @@ boost::beast::http::status tash::edge::add(const std::string& from, const std::s
 
 
 nlohmann::json tash::collection::by_id(const std::string& id){
-    tash::http_response_type response = _conn.query("_api/document/"+id);
+    tash::http_response_type response = _conn.send(boost::beast::http::verb::get, {"_api/document/", id});
     if(response.result() == boost::beast::http::status::ok){
-        nlohmann::json json = nlohmann::json::parse(boost::beast::buffers_to_string(response.body().data()));
-        return json;
+        return tash::connection::parse(response);
     }
     return nlohmann::json(nullptr);
 }
 
+void tash::collection::start_by_id(const std::string& id, std::function<void(boost::system::error_code, nlohmann::json)> handler){
+    _conn.async_query(_conn.request("_api/document/"+id), [handler](boost::system::error_code ec, tash::http_response_type response){
+        nlohmann::json json(nullptr);
+        if(!ec && response.result() == boost::beast::http::status::ok){
+            try{
+                json = tash::connection::parse(response);
+            }catch(const std::exception&){
+                ec = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+            }
+        }
+        handler(ec, json);
+    });
+}
+
 nlohmann::json tash::collection::by_key(const std::string& key){
-    return by_id((boost::format("%1%/%2%") % _name % key).str());
+    tash::http_response_type response = _conn.send(boost::beast::http::verb::get, {"_api/document/", _name, "/", key});
+    if(response.result() == boost::beast::http::status::ok){
+        return tash::connection::parse(response);
+    }
+    return nlohmann::json(nullptr);
 }
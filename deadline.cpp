@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/deadline.h"
+#include <poll.h>
+#include <cerrno>
+#include <climits>
+#include <sys/socket.h>
+
+tash::timeouts::timeouts(std::chrono::milliseconds total, std::chrono::milliseconds connect, std::chrono::milliseconds write, std::chrono::milliseconds first_byte): connect(connect), write(write), first_byte(first_byte), total(total){}
+
+tash::cancellation::cancellation(): _state(new state){
+    _state->_cancelled = false;
+    _state->_next = 0;
+}
+
+void tash::cancellation::cancel(){
+    std::map<std::size_t, std::function<void()>> callbacks;
+    {
+        boost::mutex::scoped_lock lock(_state->_mutex);
+        if(_state->_cancelled){
+            return;
+        }
+        _state->_cancelled = true;
+        callbacks.swap(_state->_callbacks);
+    }
+    for(auto& callback: callbacks){
+        callback.second();
+    }
+}
+
+bool tash::cancellation::cancelled() const{
+    boost::mutex::scoped_lock lock(_state->_mutex);
+    return _state->_cancelled;
+}
+
+std::size_t tash::cancellation::subscribe(std::function<void()> callback) const{
+    {
+        boost::mutex::scoped_lock lock(_state->_mutex);
+        if(!_state->_cancelled){
+            std::size_t id = ++_state->_next;
+            _state->_callbacks[id] = callback;
+            return id;
+        }
+    }
+    callback();
+    return 0;
+}
+
+void tash::cancellation::unsubscribe(std::size_t id) const{
+    boost::mutex::scoped_lock lock(_state->_mutex);
+    _state->_callbacks.erase(id);
+}
+
+tash::request_options::request_options(){}
+tash::request_options::request_options(const tash::timeouts& limits): timeouts(limits){}
+tash::request_options::request_options(const tash::timeouts& limits, const tash::cancellation& cancel): timeouts(limits), token(cancel){}
+
+tash::deadline::deadline(const tash::request_options& options): _options(options), _total(clock_type::time_point::max()){
+    if(options.timeouts.total.count() > 0){
+        _total = clock_type::now() + options.timeouts.total;
+    }
+}
+
+tash::deadline::clock_type::time_point tash::deadline::phase(std::chrono::milliseconds limit) const{
+    if(limit.count() <= 0){
+        return _total;
+    }
+    return std::min(_total, clock_type::now() + limit);
+}
+
+boost::system::error_code tash::deadline::check(clock_type::time_point limit) const{
+    if(token() && token()->cancelled()){
+        return boost::asio::error::operation_aborted;
+    }
+    if(limit != clock_type::time_point::max() && clock_type::now() >= limit){
+        return boost::asio::error::timed_out;
+    }
+    return boost::system::error_code();
+}
+
+void tash::wait(boost::asio::generic::stream_protocol::socket& socket, bool writable, const tash::deadline& deadline, deadline::clock_type::time_point limit, boost::system::error_code& ec){
+    // a cancellable wait wakes up regularly to look at the token
+    const std::chrono::milliseconds slice(50);
+    while(true){
+        ec = deadline.check(limit);
+        if(ec){
+            return;
+        }
+        int timeout = -1;
+        if(limit != deadline::clock_type::time_point::max()){
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(limit - deadline::clock_type::now()) + std::chrono::milliseconds(1);
+            timeout = static_cast<int>(std::min<long long>(remaining.count(), INT_MAX));
+        }
+        if(deadline.token() && (timeout < 0 || timeout > slice.count())){
+            timeout = static_cast<int>(slice.count());
+        }
+        pollfd descriptor;
+        descriptor.fd      = socket.native_handle();
+        descriptor.events  = writable ? POLLOUT : POLLIN;
+        descriptor.revents = 0;
+        int ready = ::poll(&descriptor, 1, timeout);
+        if(ready > 0){
+            // errors and hang ups are reported by the operation that is retried
+            return;
+        }
+        if(ready < 0 && errno != EINTR){
+            ec = boost::system::error_code(errno, boost::system::system_category());
+            return;
+        }
+    }
+}
+
+void tash::connect(boost::asio::generic::stream_protocol::socket& socket, const boost::asio::generic::stream_protocol::endpoint& endpoint, const tash::deadline& deadline, boost::system::error_code& ec){
+    boost::system::error_code ignored;
+    socket.close(ignored);
+    socket.open(endpoint.protocol(), ec);
+    if(ec){
+        return;
+    }
+    socket.non_blocking(true, ec);
+    // asio's synchronous connect waits without a limit even on a non blocking socket
+    if(!ec && ::connect(socket.native_handle(), endpoint.data(), static_cast<socklen_t>(endpoint.size())) != 0){
+        ec = boost::system::error_code(errno, boost::system::system_category());
+    }
+    if(ec == boost::asio::error::in_progress || ec == boost::asio::error::would_block){
+        tash::wait(socket, true, deadline, deadline.phase(deadline.timeouts().connect), ec);
+        if(!ec){
+            int error = 0;
+            socklen_t length = sizeof(error);
+            if(::getsockopt(socket.native_handle(), SOL_SOCKET, SO_ERROR, &error, &length) != 0){
+                error = errno;
+            }
+            ec = boost::system::error_code(error, boost::system::system_category());
+        }
+    }
+    socket.non_blocking(false, ignored);
+    if(ec){
+        socket.close(ignored);
+    }
+}
+
+tash::deadline_stream::deadline_stream(boost::asio::generic::stream_protocol::socket& socket, const tash::deadline& deadline): _socket(socket), _deadline(deadline), _writing(false), _reading(false), _received(false){
+    boost::system::error_code ignored;
+    _socket.non_blocking(true, ignored);
+}
+
+tash::deadline_stream::~deadline_stream(){
+    boost::system::error_code ignored;
+    _socket.non_blocking(false, ignored);
+}
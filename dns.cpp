@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/dns.h"
+#include <algorithm>
+#include <boost/make_shared.hpp>
+#include <boost/lexical_cast.hpp>
+
+tash::dns_cache::dns_cache(boost::asio::io_context& io, const std::string& host, unsigned port, clock_type::duration ttl): _resolver(io), _host(host), _service(boost::lexical_cast<std::string>(port)), _ttl(ttl), _resolutions(0), _pinned(false), _refreshing(false), _lifeline(boost::make_shared<lifeline>()){
+    _lifeline->cache = this;
+}
+
+tash::dns_cache::~dns_cache(){
+    boost::mutex::scoped_lock lock(_lifeline->mutex);
+    _lifeline->cache = nullptr;
+}
+
+tash::dns_cache::clock_type::duration tash::dns_cache::ttl() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _ttl;
+}
+
+tash::dns_cache& tash::dns_cache::ttl(clock_type::duration duration){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(_resolutions > 0){
+        _expiry += duration - _ttl;
+    }
+    _ttl = duration;
+    return *this;
+}
+
+std::vector<tash::dns_cache::endpoint_type> tash::dns_cache::endpoints(){
+    std::vector<endpoint_type> stale;
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        if(_pinned || (!_endpoints.empty() && clock_type::now() < _expiry)){
+            return _endpoints;
+        }
+        stale = _endpoints;
+    }
+    if(stale.empty()){
+        // there is nothing to serve until the host has been resolved
+        try{
+            refresh();
+        }catch(const boost::system::system_error&){
+            boost::mutex::scoped_lock lock(_mutex);
+            if(_endpoints.empty()){
+                throw;
+            }
+        }
+        boost::mutex::scoped_lock lock(_mutex);
+        return _endpoints;
+    }
+    boost::mutex::scoped_lock resolving(_resolving, boost::try_to_lock);
+    if(!resolving.owns_lock()){
+        // another thread is resolving the host already
+        return stale;
+    }
+    try{
+        resolve();
+    }catch(const boost::system::system_error&){
+        // the stale addresses are used until a resolution succeeds
+    }
+    boost::mutex::scoped_lock lock(_mutex);
+    return _endpoints;
+}
+
+void tash::dns_cache::async_endpoints(endpoints_handler handler){
+    std::vector<endpoint_type> endpoints;
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        bool fresh = _pinned || (!_endpoints.empty() && clock_type::now() < _expiry);
+        if(!fresh && !_refreshing){
+            start_refresh();
+        }
+        if(_endpoints.empty()){
+            // there is nothing to serve until the host has been resolved
+            _waiting.push_back(handler);
+            return;
+        }
+        endpoints = _endpoints;
+    }
+    handler(boost::system::error_code(), endpoints);
+}
+
+void tash::dns_cache::start_refresh(){
+    _refreshing = true;
+    boost::shared_ptr<lifeline> alive = _lifeline;
+    // a resolver of its own, _resolver may be resolving synchronously on another thread
+    boost::shared_ptr<boost::asio::ip::tcp::resolver> resolver = boost::make_shared<boost::asio::ip::tcp::resolver>(_resolver.get_executor());
+    resolver->async_resolve(_host, _service, [alive, resolver](boost::system::error_code ec, boost::asio::ip::tcp::resolver::results_type results){
+        std::vector<endpoints_handler> waiting;
+        std::vector<endpoint_type> endpoints;
+        {
+            boost::mutex::scoped_lock guard(alive->mutex);
+            if(!alive->cache){
+                return;
+            }
+            dns_cache& cache = *alive->cache;
+            if(!ec){
+                cache.store(results);
+            }
+            boost::mutex::scoped_lock lock(cache._mutex);
+            cache._refreshing = false;
+            waiting.swap(cache._waiting);
+            endpoints = cache._endpoints;
+        }
+        if(!endpoints.empty()){
+            // the stale addresses are used until a resolution succeeds
+            ec = boost::system::error_code();
+        }else if(!ec){
+            ec = boost::asio::error::host_not_found;
+        }
+        for(const endpoints_handler& handler: waiting){
+            handler(ec, endpoints);
+        }
+    });
+}
+
+void tash::dns_cache::prefer(const endpoint_type& endpoint){
+    boost::mutex::scoped_lock lock(_mutex);
+    std::vector<endpoint_type>::iterator it = std::find(_endpoints.begin(), _endpoints.end(), endpoint);
+    if(it != _endpoints.end()){
+        std::rotate(_endpoints.begin(), it, _endpoints.end());
+    }
+}
+
+void tash::dns_cache::failed(const endpoint_type& endpoint){
+    boost::mutex::scoped_lock lock(_mutex);
+    std::vector<endpoint_type>::iterator it = std::find(_endpoints.begin(), _endpoints.end(), endpoint);
+    if(it != _endpoints.end()){
+        std::rotate(it, it+1, _endpoints.end());
+    }
+}
+
+tash::dns_cache& tash::dns_cache::pin(const endpoint_type& endpoint){
+    boost::mutex::scoped_lock lock(_mutex);
+    _endpoints.assign(1, endpoint);
+    _pinned = true;
+    return *this;
+}
+
+void tash::dns_cache::refresh(){
+    std::size_t seen;
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        seen = _resolutions;
+    }
+    // only one thread resolves at a time
+    boost::mutex::scoped_lock resolving(_resolving);
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        if(_resolutions != seen && !_endpoints.empty() && clock_type::now() < _expiry){
+            // resolved by another thread while this one waited
+            return;
+        }
+    }
+    resolve();
+}
+
+void tash::dns_cache::resolve(){
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        if(_pinned){
+            return;
+        }
+    }
+    store(_resolver.resolve(_host, _service));
+}
+
+void tash::dns_cache::store(const boost::asio::ip::tcp::resolver::results_type& results){
+    std::vector<endpoint_type> endpoints;
+    for(const boost::asio::ip::tcp::resolver::results_type::value_type& entry: results){
+        endpoint_type address(entry.endpoint());
+        if(std::find(endpoints.begin(), endpoints.end(), address) == endpoints.end()){
+            endpoints.push_back(address);
+        }
+    }
+    boost::mutex::scoped_lock lock(_mutex);
+    if(!_endpoints.empty() && !endpoints.empty()){
+        // keep the address currently preferred in front if it is still valid
+        std::vector<endpoint_type>::iterator it = std::find(endpoints.begin(), endpoints.end(), _endpoints.front());
+        if(it != endpoints.end()){
+            std::rotate(endpoints.begin(), it, endpoints.end());
+        }
+    }
+    _endpoints.swap(endpoints);
+    _expiry = clock_type::now() + _ttl;
+    ++_resolutions;
+}
+
+void tash::dns_cache::invalidate(){
+    boost::mutex::scoped_lock lock(_mutex);
+    _expiry = clock_type::time_point();
+}
+
+std::size_t tash::dns_cache::resolutions() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _resolutions;
+}
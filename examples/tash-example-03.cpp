@@ -0,0 +1,43 @@
+#include <iostream>
+#include <tash/arango.h>
+#include <boost/asio/co_spawn.hpp>
+#include <boost/asio/detached.hpp>
+
+#if defined(TASH_HAS_COROUTINES)
+
+tash::awaitable<void> students(tash::shell& school){
+    using namespace tash;
+    
+    tash::vertex students(school, "students");
+    nlohmann::json document = {
+        {"name", "Hijibijbij"},
+        {"fathers_name", "Hijibijbij"}
+    };
+    boost::beast::http::status status = co_await students.async_add(document);
+    std::cout << "add: " << status << " " << document << std::endl;
+    nlohmann::json hijibijbij = co_await students.async_by_key(document["_key"].get<std::string>());
+    std::cout << "by_key: " << hijibijbij << std::endl;
+    
+    tash::cursor cursor = co_await school.async_aql(select("s").in("students") / yield("s"));
+    tash::async_documents documents(cursor);
+    nlohmann::json student;
+    while(co_await documents.next(student)){
+        std::cout << student << std::endl;
+    }
+}
+
+int main(){
+    tash::shell school("school"); // shell("school", "localhost", 8529, "root", "root")
+    boost::asio::co_spawn(school.io(), students(school), boost::asio::detached);
+    school.io().run();
+    return 0;
+}
+
+#else
+
+int main(){
+    std::cout << "tash-example-03 requires C++20 coroutines" << std::endl;
+    return 0;
+}
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <tash/arango.h>
+
+// counts every allocation made by the process, including the ones made inside tash and beast
+// against a local test server this prints about 7 for request(), 14 for query(request()), 7 for send() and 25 for by_key()
+// send() saves the allocations of the request, the response it returns is still allocated per call
+static std::atomic<std::size_t> allocations(0);
+
+void* operator new(std::size_t size){
+    ++allocations;
+    if(void* p = std::malloc(size ? size : 1)){
+        return p;
+    }
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept{
+    std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept{
+    std::free(p);
+}
+
+template <typename F>
+void measure(const std::string& label, std::size_t iterations, F f){
+    f(); // warm up the pool and the per thread buffers
+    std::size_t before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    for(std::size_t i = 0; i < iterations; ++i){
+        f();
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    std::cout << label << ": " << double(allocations.load() - before) / iterations << " allocations, " << double(elapsed.count()) / iterations << "us per call" << std::endl;
+}
+
+int main(int argc, char** argv){
+    tash::shell school("school"); // shell("school", "localhost", 8529, "root", "root")
+    tash::vertex students(school, "students");
+    const std::size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    
+    measure("request()", iterations, [&](){
+        tash::http_request_type request = school.request("_api/document/students/1234");
+    });
+    measure("query(request())", iterations, [&](){
+        school.query("_api/document/students/1234");
+    });
+    measure("send()", iterations, [&](){
+        school.send(boost::beast::http::verb::get, {"_api/document/students/1234"});
+    });
+    measure("by_key()", iterations, [&](){
+        students.by_key("1234");
+    });
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+#include <thread>
+#include <future>
+#include <vector>
+#include <iostream>
+#include <tash/arango.h>
+#include <boost/asio/use_future.hpp>
+
+int main(){
+    // one executor shared by two connections, its workers run the completions of both
+    boost::shared_ptr<tash::executor> executor = boost::make_shared<tash::executor>(std::max(2u, std::thread::hardware_concurrency()));
+    tash::shell loader(executor, "school", "localhost", 8529, "root", "root");
+    tash::shell reader(executor, "school", "localhost", 8529, "root", "root");
+    // alternatively a connection made without an executor runs its own io_context on workers of its own, e.g. shell.threads(2)
+    
+    tash::vertex students(loader, "students");
+    std::vector<std::future<boost::beast::http::status>> added;
+    for(int i = 0; i < 1000; ++i){
+        added.push_back(students.async_add(nlohmann::json{{"name", "student"}, {"roll", i}}, boost::asio::use_future));
+    }
+    std::size_t created = 0;
+    for(std::future<boost::beast::http::status>& status: added){
+        boost::beast::http::status code = status.get();
+        // 201 if the document was synced to disk, 202 otherwise
+        created += code == boost::beast::http::status::created || code == boost::beast::http::status::accepted;
+    }
+    std::cout << created << " students added" << std::endl;
+    
+    std::future<tash::http_response_type> version = reader.async_query(reader.request("/_api/version"), boost::asio::use_future);
+    std::cout << tash::connection::parse(version.get()) << std::endl;
+    return 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/executor.h"
+
+tash::executor::executor(std::size_t threads): _size(0){
+    start(threads);
+}
+
+tash::executor::~executor(){
+    stop();
+}
+
+std::size_t tash::executor::size() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _size;
+}
+
+tash::executor& tash::executor::start(std::size_t threads){
+    if(threads == 0){
+        return *this;
+    }
+    boost::mutex::scoped_lock lock(_mutex);
+    if(!_work){
+        _io.restart();
+        _work.reset(new work_type(boost::asio::make_work_guard(_io)));
+    }
+    for(std::size_t i = 0; i < threads; ++i){
+        _workers.create_thread([this](){
+            _io.run();
+        });
+    }
+    _size += threads;
+    return *this;
+}
+
+void tash::executor::stop(){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(!_work){
+        return;
+    }
+    _work.reset();
+    _io.stop();
+    _workers.join_all();
+    _size = 0;
+}
@@ -0,0 +1,435 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/hpack.h"
+#include <array>
+#include <algorithm>
+#include <stdexcept>
+
+namespace{
+    
+    const tash::hpack::field_type static_table[] = {
+        {":authority", ""},
+        {":method", "GET"},
+        {":method", "POST"},
+        {":path", "/"},
+        {":path", "/index.html"},
+        {":scheme", "http"},
+        {":scheme", "https"},
+        {":status", "200"},
+        {":status", "204"},
+        {":status", "206"},
+        {":status", "304"},
+        {":status", "400"},
+        {":status", "404"},
+        {":status", "500"},
+        {"accept-charset", ""},
+        {"accept-encoding", "gzip, deflate"},
+        {"accept-language", ""},
+        {"accept-ranges", ""},
+        {"accept", ""},
+        {"access-control-allow-origin", ""},
+        {"age", ""},
+        {"allow", ""},
+        {"authorization", ""},
+        {"cache-control", ""},
+        {"content-disposition", ""},
+        {"content-encoding", ""},
+        {"content-language", ""},
+        {"content-length", ""},
+        {"content-location", ""},
+        {"content-range", ""},
+        {"content-type", ""},
+        {"cookie", ""},
+        {"date", ""},
+        {"etag", ""},
+        {"expect", ""},
+        {"expires", ""},
+        {"from", ""},
+        {"host", ""},
+        {"if-match", ""},
+        {"if-modified-since", ""},
+        {"if-none-match", ""},
+        {"if-range", ""},
+        {"if-unmodified-since", ""},
+        {"last-modified", ""},
+        {"link", ""},
+        {"location", ""},
+        {"max-forwards", ""},
+        {"proxy-authenticate", ""},
+        {"proxy-authorization", ""},
+        {"range", ""},
+        {"referer", ""},
+        {"refresh", ""},
+        {"retry-after", ""},
+        {"server", ""},
+        {"set-cookie", ""},
+        {"strict-transport-security", ""},
+        {"transfer-encoding", ""},
+        {"user-agent", ""},
+        {"vary", ""},
+        {"via", ""},
+        {"www-authenticate", ""}
+    };
+    
+    const std::size_t static_size = sizeof(static_table) / sizeof(static_table[0]);
+    
+    /**
+     * code lengths of the 256 octets and of EOS, the code is canonical, so the lengths determine the codes
+     */
+    const std::uint8_t huffman_lengths[257] = {
+        13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+        28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+        6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+        5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+        13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+        7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+        15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+        6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+        20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+        24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+        22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+        21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+        26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+        19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+        20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+        26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+        30
+    };
+    
+    /**
+     * the canonical codes, codes of the same length are consecutive in the order of their symbols
+     */
+    struct huffman_code{
+        std::array<std::uint32_t, 257> _codes;
+        std::array<std::uint32_t, 31>  _first;
+        std::array<std::uint32_t, 31>  _count;
+        std::array<std::uint32_t, 31>  _offset;
+        std::array<std::uint16_t, 257> _symbols;
+        
+        huffman_code(){
+            _count.fill(0);
+            for(std::size_t symbol = 0; symbol < 257; ++symbol){
+                ++_count[huffman_lengths[symbol]];
+            }
+            std::uint32_t code = 0;
+            std::uint32_t offset = 0;
+            for(std::size_t length = 1; length < 31; ++length){
+                code = (code + _count[length-1]) << 1;
+                _first[length]  = code;
+                _offset[length] = offset;
+                offset += _count[length];
+            }
+            _first[0] = _offset[0] = 0;
+            std::array<std::uint32_t, 31> next = _first;
+            std::array<std::uint32_t, 31> slot = _offset;
+            for(std::size_t symbol = 0; symbol < 257; ++symbol){
+                std::uint8_t length = huffman_lengths[symbol];
+                _codes[symbol] = next[length]++;
+                _symbols[slot[length]++] = static_cast<std::uint16_t>(symbol);
+            }
+        }
+    };
+    
+    const huffman_code& huffman(){
+        static const huffman_code code;
+        return code;
+    }
+    
+    /**
+     * integer with an N bit prefix, the bits above the prefix belong to the representation and are passed in flags
+     */
+    void encode_integer(std::uint64_t value, unsigned prefix, std::uint8_t flags, std::string& out){
+        const std::uint64_t max = (1u << prefix) - 1;
+        if(value < max){
+            out.push_back(static_cast<char>(flags | value));
+            return;
+        }
+        out.push_back(static_cast<char>(flags | max));
+        value -= max;
+        while(value >= 128){
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+    
+    std::uint64_t decode_integer(const std::uint8_t*& p, const std::uint8_t* end, unsigned prefix){
+        if(p == end){
+            throw std::invalid_argument("truncated HPACK integer");
+        }
+        const std::uint64_t max = (1u << prefix) - 1;
+        std::uint64_t value = *p++ & max;
+        if(value < max){
+            return value;
+        }
+        for(unsigned shift = 0; ; shift += 7){
+            if(p == end || shift > 28){
+                throw std::invalid_argument("malformed HPACK integer");
+            }
+            std::uint8_t byte = *p++;
+            value += static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if(!(byte & 0x80)){
+                return value;
+            }
+        }
+    }
+    
+    /**
+     * string literal, Huffman coded whenever that is shorter
+     */
+    void encode_string(const std::string& text, std::string& out){
+        std::size_t coded = tash::hpack::huffman_size(text);
+        if(coded < text.size()){
+            encode_integer(coded, 7, 0x80, out);
+            tash::hpack::huffman_encode(text, out);
+        }else{
+            encode_integer(text.size(), 7, 0x00, out);
+            out.append(text);
+        }
+    }
+    
+    std::string decode_string(const std::uint8_t*& p, const std::uint8_t* end){
+        if(p == end){
+            throw std::invalid_argument("truncated HPACK string");
+        }
+        const bool coded = *p & 0x80;
+        std::uint64_t length = decode_integer(p, end, 7);
+        if(length > static_cast<std::uint64_t>(end - p)){
+            throw std::invalid_argument("truncated HPACK string");
+        }
+        const std::uint8_t* begin = p;
+        p += length;
+        return coded ? tash::hpack::huffman_decode(begin, length) : std::string(reinterpret_cast<const char*>(begin), length);
+    }
+    
+    std::size_t entry_size(const tash::hpack::field_type& field){
+        return field.first.size() + field.second.size() + 32;
+    }
+    
+    /**
+     * fields whose values change with every request would only push useful entries out of the table
+     */
+    bool indexable(const tash::hpack::field_type& field){
+        return field.first != ":path" && field.first != "content-length" && field.first != "etag" && field.first != "if-match" && field.first != "if-none-match";
+    }
+}
+
+tash::hpack::table::table(std::size_t capacity): _size(0), _capacity(capacity){}
+
+void tash::hpack::table::capacity(std::size_t capacity){
+    _capacity = capacity;
+    while(_size > _capacity){
+        _size -= entry_size(_entries.back());
+        _entries.pop_back();
+    }
+}
+
+void tash::hpack::table::insert(const field_type& field){
+    std::size_t size = entry_size(field);
+    while(!_entries.empty() && _size + size > _capacity){
+        _size -= entry_size(_entries.back());
+        _entries.pop_back();
+    }
+    // an entry larger than the whole table just empties it
+    if(size <= _capacity){
+        _entries.push_front(field);
+        _size += size;
+    }
+}
+
+const tash::hpack::field_type& tash::hpack::table::at(std::size_t index) const{
+    if(index == 0 || index > static_size + _entries.size()){
+        throw std::invalid_argument("HPACK index out of range");
+    }
+    if(index <= static_size){
+        return static_table[index-1];
+    }
+    return _entries[index-static_size-1];
+}
+
+std::size_t tash::hpack::table::find(const field_type& field, bool& exact) const{
+    std::size_t named = 0;
+    exact = false;
+    for(std::size_t i = 0; i < static_size; ++i){
+        if(static_table[i].first == field.first){
+            if(static_table[i].second == field.second){
+                exact = true;
+                return i+1;
+            }
+            if(!named){
+                named = i+1;
+            }
+        }
+    }
+    for(std::size_t i = 0; i < _entries.size(); ++i){
+        if(_entries[i].first == field.first){
+            if(_entries[i].second == field.second){
+                exact = true;
+                return static_size+i+1;
+            }
+            if(!named){
+                named = static_size+i+1;
+            }
+        }
+    }
+    return named;
+}
+
+tash::hpack::encoder::encoder(std::size_t capacity): _table(capacity), _limit(capacity), _resized(false){}
+
+void tash::hpack::encoder::limit(std::size_t size){
+    std::size_t capacity = std::min(size, _limit);
+    if(capacity != _table.capacity()){
+        _table.capacity(capacity);
+        _resized = true;
+    }
+}
+
+void tash::hpack::encoder::encode(const fields_type& fields, std::string& out){
+    if(_resized){
+        // the decoder learns about the new size at the start of the next block
+        encode_integer(_table.capacity(), 5, 0x20, out);
+        _resized = false;
+    }
+    for(const field_type& field: fields){
+        bool exact = false;
+        std::size_t index = _table.find(field, exact);
+        if(exact){
+            encode_integer(index, 7, 0x80, out);
+            continue;
+        }
+        const bool indexed = indexable(field) && entry_size(field) <= _table.capacity();
+        // literal with incremental indexing, or without indexing
+        if(indexed){
+            encode_integer(index, 6, 0x40, out);
+        }else{
+            encode_integer(index, 4, 0x00, out);
+        }
+        if(!index){
+            encode_string(field.first, out);
+        }
+        encode_string(field.second, out);
+        if(indexed){
+            _table.insert(field);
+        }
+    }
+}
+
+tash::hpack::decoder::decoder(std::size_t capacity): _table(capacity), _limit(capacity){}
+
+tash::hpack::fields_type tash::hpack::decoder::decode(const std::uint8_t* data, std::size_t size){
+    fields_type fields;
+    const std::uint8_t* p = data;
+    const std::uint8_t* end = data + size;
+    while(p != end){
+        const std::uint8_t byte = *p;
+        if(byte & 0x80){
+            // indexed field
+            fields.push_back(_table.at(decode_integer(p, end, 7)));
+            continue;
+        }
+        if((byte & 0xe0) == 0x20){
+            // dynamic table size update
+            std::uint64_t capacity = decode_integer(p, end, 5);
+            if(capacity > _limit){
+                throw std::invalid_argument("HPACK table size exceeds the limit");
+            }
+            _table.capacity(capacity);
+            continue;
+        }
+        // literal with incremental indexing (01), without indexing (0000) or never indexed (0001)
+        const bool indexed = (byte & 0xc0) == 0x40;
+        std::uint64_t index = decode_integer(p, end, indexed ? 6 : 4);
+        field_type field;
+        field.first  = index ? _table.at(index).first : decode_string(p, end);
+        field.second = decode_string(p, end);
+        if(indexed){
+            _table.insert(field);
+        }
+        fields.push_back(std::move(field));
+    }
+    return fields;
+}
+
+std::size_t tash::hpack::huffman_size(const std::string& text){
+    std::size_t bits = 0;
+    for(char c: text){
+        bits += huffman_lengths[static_cast<std::uint8_t>(c)];
+    }
+    return (bits + 7) / 8;
+}
+
+void tash::hpack::huffman_encode(const std::string& text, std::string& out){
+    const huffman_code& code = huffman();
+    std::uint64_t buffer = 0;
+    unsigned bits = 0;
+    for(char c: text){
+        std::uint8_t symbol = static_cast<std::uint8_t>(c);
+        buffer = (buffer << huffman_lengths[symbol]) | code._codes[symbol];
+        bits += huffman_lengths[symbol];
+        while(bits >= 8){
+            bits -= 8;
+            out.push_back(static_cast<char>((buffer >> bits) & 0xff));
+        }
+    }
+    if(bits > 0){
+        // padded with the most significant bits of EOS, which are all ones
+        out.push_back(static_cast<char>(((buffer << (8 - bits)) | (0xff >> bits)) & 0xff));
+    }
+}
+
+std::string tash::hpack::huffman_decode(const std::uint8_t* data, std::size_t size){
+    const huffman_code& code = huffman();
+    std::string text;
+    text.reserve(size * 8 / 5);
+    std::uint32_t value = 0;
+    std::size_t length = 0;
+    for(std::size_t i = 0; i < size; ++i){
+        for(int bit = 7; bit >= 0; --bit){
+            value = (value << 1) | ((data[i] >> bit) & 1);
+            ++length;
+            if(length > 30){
+                throw std::invalid_argument("malformed Huffman code");
+            }
+            if(value - code._first[length] < code._count[length]){
+                std::uint16_t symbol = code._symbols[code._offset[length] + value - code._first[length]];
+                if(symbol == 256){
+                    throw std::invalid_argument("EOS in Huffman coded string");
+                }
+                text.push_back(static_cast<char>(symbol));
+                value  = 0;
+                length = 0;
+            }
+        }
+    }
+    // the padding is shorter than a byte and consists of ones
+    if(length > 7 || value != (1u << length) - 1){
+        throw std::invalid_argument("malformed Huffman padding");
+    }
+    return text;
+}
@@ -0,0 +1,752 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/http2.h"
+#include "tash/pool.h"
+#include "tash/compression.h"
+#include <future>
+#include <memory>
+#include <limits>
+#include <cctype>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/lexical_cast.hpp>
+
+namespace{
+    
+    enum frame_type: std::uint8_t{
+        frame_data          = 0x0,
+        frame_headers       = 0x1,
+        frame_priority      = 0x2,
+        frame_rst_stream    = 0x3,
+        frame_settings      = 0x4,
+        frame_push_promise  = 0x5,
+        frame_ping          = 0x6,
+        frame_goaway        = 0x7,
+        frame_window_update = 0x8,
+        frame_continuation  = 0x9
+    };
+    
+    enum frame_flag: std::uint8_t{
+        flag_end_stream     = 0x1,
+        flag_ack            = 0x1,
+        flag_end_headers    = 0x4,
+        flag_padded         = 0x8,
+        flag_priority       = 0x20
+    };
+    
+    const std::uint16_t setting_header_table_size     = 0x1;
+    const std::uint16_t setting_enable_push           = 0x2;
+    const std::uint16_t setting_max_concurrent_streams = 0x3;
+    const std::uint16_t setting_initial_window_size   = 0x4;
+    const std::uint16_t setting_max_frame_size        = 0x5;
+    
+    const std::uint32_t error_refused_stream = 0x7;
+    const std::uint32_t error_cancel         = 0x8;
+    
+    /**
+     * flow control window granted to the server per stream and for the whole connection
+     */
+    const std::int64_t receive_window = 1 << 24;
+    /**
+     * largest frame the server may send
+     */
+    const std::uint32_t receive_frame = 1 << 20;
+    
+    std::uint32_t read_uint(const std::uint8_t* p, std::size_t width){
+        std::uint32_t value = 0;
+        for(std::size_t i = 0; i < width; ++i){
+            value = (value << 8) | p[i];
+        }
+        return value;
+    }
+    
+    void write_uint(std::string& out, std::uint32_t value, std::size_t width){
+        for(std::size_t i = width; i > 0; --i){
+            out.push_back(static_cast<char>((value >> (8*(i-1))) & 0xff));
+        }
+    }
+    
+    std::string frame_header(std::size_t length, std::uint8_t type, std::uint8_t flags, std::uint32_t stream){
+        std::string header;
+        write_uint(header, static_cast<std::uint32_t>(length), 3);
+        header.push_back(static_cast<char>(type));
+        header.push_back(static_cast<char>(flags));
+        write_uint(header, stream & 0x7fffffff, 4);
+        return header;
+    }
+    
+    boost::system::error_code protocol_error(){
+        return boost::system::errc::make_error_code(boost::system::errc::protocol_error);
+    }
+    
+    /**
+     * the pseudo headers followed by the fields of the request, without those that only make sense for HTTP/1.1
+     */
+    tash::hpack::fields_type fields(const tash::multiplexer::request_type& request){
+        tash::hpack::fields_type fields;
+        fields.emplace_back(":method", std::string(request.method_string()));
+        fields.emplace_back(":scheme", "http");
+        if(request.find(boost::beast::http::field::host) != request.end()){
+            fields.emplace_back(":authority", std::string(request[boost::beast::http::field::host]));
+        }
+        fields.emplace_back(":path", std::string(request.target()));
+        for(const auto& field: request){
+            switch(field.name()){
+                case boost::beast::http::field::host:
+                case boost::beast::http::field::connection:
+                case boost::beast::http::field::keep_alive:
+                case boost::beast::http::field::proxy_connection:
+                case boost::beast::http::field::transfer_encoding:
+                case boost::beast::http::field::upgrade:
+                case boost::beast::http::field::te:
+                    continue;
+                default: break;
+            }
+            std::string name(field.name_string());
+            for(char& c: name){
+                c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            }
+            fields.emplace_back(std::move(name), std::string(field.value()));
+        }
+        return fields;
+    }
+}
+
+tash::http2::http2(tash::dns_cache& dns)
+    : _work(boost::asio::make_work_guard(_io)), _socket(_io), _dns(dns), _connected(false), _generation(0), _next(1), _count(0), _alive(false), _current(0), _next_stream(1), _draining(false),
+      _max_streams(std::numeric_limits<std::uint32_t>::max()), _max_frame(16384), _initial_window(65535), _window(65535), _received(0), _writing(false), _continued(0), _ended(false){
+    _thread = boost::thread([this](){
+        _io.run();
+    });
+}
+
+tash::http2::~http2(){
+    _work.reset();
+    _io.stop();
+    _thread.join();
+    for(auto& pending: _pending){
+        pending.second._handler(boost::asio::error::operation_aborted, response_type(), true);
+    }
+}
+
+std::size_t tash::http2::pending(){
+    return _count;
+}
+
+void tash::http2::connect(const tash::deadline& deadline){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(_connected){
+        return;
+    }
+    boost::system::error_code ec = boost::asio::error::host_not_found;
+    for(const tash::dns_cache::endpoint_type& endpoint: _dns.endpoints()){
+        tash::connect(_socket, endpoint, deadline, ec);
+        if(!ec){
+            _dns.prefer(endpoint);
+            break;
+        }
+        if(deadline.check(deadline.total())){
+            throw boost::system::system_error(ec);
+        }
+        _dns.failed(endpoint);
+    }
+    if(ec){
+        _dns.invalidate();
+        throw boost::system::system_error(ec);
+    }
+    std::string settings;
+    try{
+        tash::channel::no_delay(_socket);
+        tash::deadline_stream stream(_socket, deadline);
+        std::string preface("PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n");
+        std::string payload;
+        write_uint(payload, setting_enable_push, 2);
+        write_uint(payload, 0, 4);
+        write_uint(payload, setting_initial_window_size, 2);
+        write_uint(payload, receive_window, 4);
+        write_uint(payload, setting_max_frame_size, 2);
+        write_uint(payload, receive_frame, 4);
+        preface += frame_header(payload.size(), frame_settings, 0, 0) + payload;
+        std::string increment;
+        write_uint(increment, receive_window - 65535, 4);
+        preface += frame_header(increment.size(), frame_window_update, 0, 0) + increment;
+        boost::asio::write(stream, boost::asio::buffer(preface));
+        // the preface of the server is a SETTINGS frame, a server that does not speak HTTP/2 answers with something else
+        std::uint8_t header[9];
+        boost::asio::read(stream, boost::asio::buffer(header, sizeof(header)));
+        std::uint32_t length = read_uint(header, 3);
+        if(header[3] != frame_settings || (header[4] & flag_ack) || length % 6 != 0 || length > receive_frame){
+            throw boost::system::system_error(protocol_error());
+        }
+        settings.resize(length);
+        boost::asio::read(stream, boost::asio::buffer(&settings[0], settings.size()));
+    }catch(const std::exception&){
+        boost::system::error_code ignored;
+        _socket.close(ignored);
+        throw;
+    }
+    _connected = true;
+    std::size_t generation = ++_generation;
+    if(_io.get_executor().running_in_this_thread()){
+        lock.unlock();
+        return established(generation, settings);
+    }
+    // posted under the lock, so requests of other threads that see the connection are posted behind it
+    boost::asio::post(_io, [this, generation, settings](){
+        established(generation, settings);
+    });
+}
+
+void tash::http2::established(std::size_t generation, const std::string& settings){
+    _alive          = true;
+    _current        = generation;
+    _next_stream    = 1;
+    _draining       = false;
+    _encoder        = tash::hpack::encoder();
+    _decoder        = tash::hpack::decoder();
+    _max_streams    = std::numeric_limits<std::uint32_t>::max();
+    _max_frame      = 16384;
+    _initial_window = 65535;
+    _window         = 65535;
+    _received       = 0;
+    _output.clear();
+    _writing        = false;
+    _input.consume(_input.size());
+    _continued      = 0;
+    this->settings(reinterpret_cast<const std::uint8_t*>(settings.data()), settings.size());
+    read(generation);
+    drain();
+}
+
+tash::http2::response_type tash::http2::send(const request_type& request, const tash::deadline& deadline){
+    connect(deadline);
+    std::shared_ptr<std::promise<response_type>> promise = std::make_shared<std::promise<response_type>>();
+    std::future<response_type> future = promise->get_future();
+    std::uint64_t id = start(request, deadline, [promise](boost::system::error_code ec, response_type res, bool){
+        if(ec){
+            promise->set_exception(std::make_exception_ptr(boost::system::system_error(ec)));
+        }else{
+            promise->set_value(std::move(res));
+        }
+    });
+    // a cancellable wait wakes up regularly to look at the token
+    const std::chrono::milliseconds slice(50);
+    while(true){
+        boost::system::error_code ec = deadline.check(deadline.total());
+        if(ec){
+            if(future.wait_for(std::chrono::seconds(0)) == std::future_status::ready){
+                // the response made it just in time
+                break;
+            }
+            abandon(id);
+            throw boost::system::system_error(ec);
+        }
+        std::chrono::steady_clock::time_point until = deadline.total();
+        if(deadline.token() && (until == std::chrono::steady_clock::time_point::max() || until - std::chrono::steady_clock::now() > slice)){
+            until = std::chrono::steady_clock::now() + slice;
+        }
+        if(until == std::chrono::steady_clock::time_point::max()){
+            future.wait();
+            break;
+        }
+        if(future.wait_until(until) == std::future_status::ready){
+            break;
+        }
+    }
+    return future.get();
+}
+
+std::uint64_t tash::http2::start(const request_type& request, const tash::deadline& deadline, handler_type handler){
+    std::uint64_t id;
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        id = _next++;
+    }
+    ++_count;
+    boost::asio::post(_io, [this, id, request, deadline, handler]() mutable{
+        _pending[id] = incoming{std::move(handler), std::move(request), 0, 0, 0, 0, response_type(), deadline};
+        begin(id);
+    });
+    return id;
+}
+
+void tash::http2::abandon(std::uint64_t id){
+    // posted behind the start() of the request, so the request is pending by then unless it completed
+    boost::asio::post(_io, [this, id](){
+        auto it = _pending.find(id);
+        if(it == _pending.end()){
+            return;
+        }
+        std::uint32_t stream = it->second._stream;
+        _pending.erase(it);
+        --_count;
+        if(stream){
+            // the server stops working on it, frames already on their way are dropped
+            _streams.erase(stream);
+            std::string code;
+            write_uint(code, error_cancel, 4);
+            frame(frame_rst_stream, 0, stream, code.data(), code.size());
+            flush();
+        }else{
+            _queued.erase(std::remove(_queued.begin(), _queued.end(), id), _queued.end());
+        }
+        if(_draining && _streams.empty() && _alive){
+            return retire();
+        }
+        drain();
+    });
+}
+
+void tash::http2::begin(std::uint64_t id){
+    if(_pending.find(id) == _pending.end()){
+        return;
+    }
+    std::size_t generation;
+    bool connected;
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        generation = _generation;
+        connected  = _connected;
+    }
+    if(!connected){
+        // blocks the thread of the socket, but no longer than the request itself may take to connect
+        try{
+            connect(*_pending[id]._deadline);
+        }catch(const boost::system::system_error& error){
+            return complete(id, error.code(), false);
+        }
+        boost::mutex::scoped_lock lock(_mutex);
+        generation = _generation;
+    }
+    if(!live(generation) || _draining || _streams.size() >= _max_streams){
+        // waits for the connection to be established, for the next connection or for a stream to complete
+        _queued.push_back(id);
+        return;
+    }
+    open(id, _pending[id]);
+    flush();
+}
+
+void tash::http2::open(std::uint64_t id, incoming& request){
+    request._stream = _next_stream;
+    _next_stream += 2;
+    if(_next_stream > 0x7fffffff){
+        // the stream ids are used up, the requests that follow go to a new connection
+        _draining = true;
+    }
+    _streams[request._stream] = id;
+    request._window = _initial_window;
+    std::string block;
+    _encoder.encode(fields(request._request), block);
+    const bool body = !request._request.body().empty();
+    // a header block is split into a HEADERS frame and CONTINUATION frames that follow it immediately
+    std::size_t offset = 0;
+    do{
+        std::size_t length = std::min<std::size_t>(block.size() - offset, _max_frame);
+        const bool last = offset + length == block.size();
+        std::uint8_t flags = last ? flag_end_headers : 0;
+        if(offset == 0 && !body){
+            flags |= flag_end_stream;
+        }
+        frame(offset == 0 ? frame_headers : frame_continuation, flags, request._stream, block.data()+offset, length);
+        offset += length;
+    }while(offset < block.size());
+    pump(request);
+}
+
+void tash::http2::pump(incoming& request){
+    const std::string& body = request._request.body();
+    while(request._offset < body.size()){
+        std::int64_t length = std::min<std::int64_t>({static_cast<std::int64_t>(body.size() - request._offset), _max_frame, request._window, _window});
+        if(length <= 0){
+            // the rest follows once the server grants more of its window
+            return;
+        }
+        const bool last = request._offset + length == body.size();
+        frame(frame_data, last ? flag_end_stream : 0, request._stream, body.data()+request._offset, length);
+        request._offset += length;
+        request._window -= length;
+        _window         -= length;
+    }
+}
+
+void tash::http2::drain(){
+    while(!_queued.empty() && _alive && !_draining && _streams.size() < _max_streams){
+        std::uint64_t id = _queued.front();
+        _queued.pop_front();
+        auto it = _pending.find(id);
+        if(it != _pending.end()){
+            open(id, it->second);
+        }
+    }
+    flush();
+}
+
+void tash::http2::complete(std::uint64_t id, const boost::system::error_code& ec, bool delivered){
+    auto it = _pending.find(id);
+    if(it == _pending.end()){
+        return;
+    }
+    incoming request = std::move(it->second);
+    _pending.erase(it);
+    --_count;
+    if(request._stream){
+        _streams.erase(request._stream);
+    }
+    boost::system::error_code error = ec;
+    if(!error){
+        request._response.version(11);
+        request._response.keep_alive(true);
+        try{
+            tash::decode(request._response);
+        }catch(const std::exception&){
+            error = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+        }
+        request._response.prepare_payload();
+    }
+    request._handler(error, error ? response_type() : std::move(request._response), delivered);
+    if(_draining && _streams.empty() && _alive){
+        return retire();
+    }
+    drain();
+}
+
+void tash::http2::frame(std::uint8_t type, std::uint8_t flags, std::uint32_t stream, const char* payload, std::size_t size){
+    _output.append(frame_header(size, type, flags, stream));
+    _output.append(payload, size);
+}
+
+void tash::http2::flush(){
+    if(_writing || _output.empty() || !_alive){
+        return;
+    }
+    // frames queued while a write is in flight go out together with the next one
+    _writing = true;
+    _written.swap(_output);
+    _output.clear();
+    std::size_t generation = _current;
+    boost::asio::async_write(_socket, boost::asio::buffer(_written), [this, generation](boost::system::error_code ec, std::size_t){
+        if(!live(generation)){
+            return;
+        }
+        _writing = false;
+        if(ec){
+            return fail(generation, ec);
+        }
+        flush();
+    });
+}
+
+void tash::http2::read(std::size_t generation){
+    _socket.async_read_some(_input.prepare(65536), [this, generation](boost::system::error_code ec, std::size_t bytes){
+        if(!live(generation)){
+            return;
+        }
+        if(ec){
+            return fail(generation, ec);
+        }
+        _input.commit(bytes);
+        try{
+            while(_input.size() >= 9 && live(generation)){
+                const std::uint8_t* data = static_cast<const std::uint8_t*>(_input.data().data());
+                std::uint32_t length = read_uint(data, 3);
+                if(length > receive_frame){
+                    return fail(generation, protocol_error());
+                }
+                if(_input.size() < 9 + length){
+                    break;
+                }
+                received(data[3], data[4], read_uint(data+5, 4) & 0x7fffffff, data+9, length);
+                if(!live(generation)){
+                    // failed while the frame was handled
+                    return;
+                }
+                _input.consume(9 + length);
+            }
+        }catch(const std::invalid_argument&){
+            // a header block that cannot be decoded leaves the compression state of both ends out of sync
+            return fail(generation, protocol_error());
+        }
+        if(live(generation)){
+            flush();
+            read(generation);
+        }
+    });
+}
+
+void tash::http2::received(std::uint8_t type, std::uint8_t flags, std::uint32_t stream, const std::uint8_t* payload, std::size_t size){
+    if(_continued && type != frame_continuation){
+        return fail(_current, protocol_error());
+    }
+    const std::uint8_t* end = payload + size;
+    if((type == frame_data || type == frame_headers) && (flags & flag_padded)){
+        if(size == 0 || payload[0] >= size){
+            return fail(_current, protocol_error());
+        }
+        end -= payload[0];
+        ++payload;
+    }
+    switch(type){
+        case frame_data:{
+            // padding counts against the window as well
+            _received += size;
+            if(_received >= receive_window / 2){
+                std::string increment;
+                write_uint(increment, static_cast<std::uint32_t>(_received), 4);
+                frame(frame_window_update, 0, 0, increment.data(), increment.size());
+                _received = 0;
+            }
+            auto it = _streams.find(stream);
+            if(it == _streams.end()){
+                // an abandoned stream
+                return;
+            }
+            std::uint64_t id = it->second;
+            incoming& request = _pending[id];
+            std::size_t length = end - payload;
+            request._response.body().commit(boost::asio::buffer_copy(request._response.body().prepare(length), boost::asio::buffer(payload, length)));
+            if(flags & flag_end_stream){
+                return complete(id, boost::system::error_code(), true);
+            }
+            request._received += size;
+            if(request._received >= receive_window / 2){
+                std::string increment;
+                write_uint(increment, static_cast<std::uint32_t>(request._received), 4);
+                frame(frame_window_update, 0, stream, increment.data(), increment.size());
+                request._received = 0;
+            }
+            return;
+        }
+        case frame_headers:
+            if(flags & flag_priority){
+                if(end - payload < 5){
+                    return fail(_current, protocol_error());
+                }
+                payload += 5;
+            }
+            _block.assign(reinterpret_cast<const char*>(payload), end - payload);
+            _continued = stream;
+            _ended     = flags & flag_end_stream;
+            if(flags & flag_end_headers){
+                headers();
+            }
+            return;
+        case frame_continuation:
+            if(!_continued || stream != _continued){
+                return fail(_current, protocol_error());
+            }
+            _block.append(reinterpret_cast<const char*>(payload), size);
+            if(flags & flag_end_headers){
+                headers();
+            }
+            return;
+        case frame_rst_stream:{
+            auto it = _streams.find(stream);
+            if(it != _streams.end() && size >= 4){
+                // a refused stream has not been processed and may be sent again
+                return complete(it->second, boost::asio::error::connection_reset, read_uint(payload, 4) != error_refused_stream);
+            }
+            return;
+        }
+        case frame_settings:
+            if(!(flags & flag_ack)){
+                if(size % 6 != 0){
+                    return fail(_current, protocol_error());
+                }
+                settings(payload, size);
+                drain();
+            }
+            return;
+        case frame_ping:
+            if(!(flags & flag_ack)){
+                frame(frame_ping, flag_ack, 0, reinterpret_cast<const char*>(payload), size);
+            }
+            return;
+        case frame_goaway:
+            if(size >= 8){
+                goaway(read_uint(payload, 4) & 0x7fffffff);
+            }
+            return;
+        case frame_window_update:{
+            if(size < 4){
+                return fail(_current, protocol_error());
+            }
+            std::uint32_t increment = read_uint(payload, 4) & 0x7fffffff;
+            if(stream == 0){
+                _window += increment;
+                for(const auto& open: _streams){
+                    pump(_pending[open.second]);
+                }
+            }else{
+                auto it = _streams.find(stream);
+                if(it != _streams.end()){
+                    incoming& request = _pending[it->second];
+                    request._window += increment;
+                    pump(request);
+                }
+            }
+            return;
+        }
+        case frame_push_promise:
+            // push has been disabled in the settings
+            return fail(_current, protocol_error());
+        default:
+            // PRIORITY and unknown frame types are ignored
+            return;
+    }
+}
+
+void tash::http2::headers(){
+    // every block is decoded, even that of an abandoned stream, to keep the table in sync with the server
+    tash::hpack::fields_type fields = _decoder.decode(reinterpret_cast<const std::uint8_t*>(_block.data()), _block.size());
+    std::uint32_t stream = _continued;
+    _continued = 0;
+    auto it = _streams.find(stream);
+    if(it == _streams.end()){
+        return;
+    }
+    std::uint64_t id = it->second;
+    response_type& response = _pending[id]._response;
+    for(const tash::hpack::field_type& field: fields){
+        if(field.first == ":status"){
+            unsigned status = 0;
+            if(!boost::conversion::try_lexical_convert(field.second, status)){
+                return fail(_current, protocol_error());
+            }
+            if(status >= 100 && status < 200){
+                // an informational response precedes the final one
+                return;
+            }
+            response.result(status);
+        }else if(!field.first.empty() && field.first[0] != ':'){
+            response.insert(field.first, field.second);
+        }
+    }
+    if(_ended){
+        complete(id, boost::system::error_code(), true);
+    }
+}
+
+void tash::http2::settings(const std::uint8_t* payload, std::size_t size){
+    for(std::size_t i = 0; i+6 <= size; i += 6){
+        std::uint16_t id    = static_cast<std::uint16_t>(read_uint(payload+i, 2));
+        std::uint32_t value = read_uint(payload+i+2, 4);
+        switch(id){
+            case setting_header_table_size:
+                _encoder.limit(value);
+                break;
+            case setting_max_concurrent_streams:
+                _max_streams = value;
+                break;
+            case setting_initial_window_size:{
+                if(value > 0x7fffffff){
+                    return fail(_current, protocol_error());
+                }
+                // the difference applies to the windows of the open streams
+                std::int64_t delta = static_cast<std::int64_t>(value) - _initial_window;
+                _initial_window = value;
+                for(const auto& open: _streams){
+                    _pending[open.second]._window += delta;
+                }
+                break;
+            }
+            case setting_max_frame_size:
+                if(value < 16384 || value > 16777215){
+                    return fail(_current, protocol_error());
+                }
+                _max_frame = value;
+                break;
+            default: break;
+        }
+    }
+    frame(frame_settings, flag_ack, 0, nullptr, 0);
+    for(const auto& open: _streams){
+        pump(_pending[open.second]);
+    }
+}
+
+void tash::http2::goaway(std::uint32_t last){
+    // streams after the last one have not been processed, they may be sent again, the others still complete
+    _draining = true;
+    std::vector<std::uint64_t> refused;
+    for(auto it = _streams.upper_bound(last); it != _streams.end(); ++it){
+        refused.push_back(it->second);
+    }
+    for(std::uint64_t id: refused){
+        complete(id, boost::asio::error::connection_aborted, false);
+    }
+    if(_streams.empty() && _alive){
+        retire();
+    }
+}
+
+void tash::http2::fail(std::size_t generation, const boost::system::error_code& ec){
+    if(!live(generation)){
+        return;
+    }
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        ++_generation;
+        _connected = false;
+        boost::system::error_code ignored;
+        _socket.close(ignored);
+    }
+    _alive = false;
+    std::map<std::uint64_t, incoming> pending;
+    pending.swap(_pending);
+    _streams.clear();
+    _queued.clear();
+    _count -= pending.size();
+    for(auto& request: pending){
+        request.second._handler(ec, response_type(), request.second._stream != 0);
+    }
+}
+
+void tash::http2::retire(){
+    // closed once the handler that drained the connection returned, it may be in the middle of reading
+    std::size_t generation = _current;
+    boost::asio::post(_io, [this, generation](){
+        if(!live(generation)){
+            return;
+        }
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            ++_generation;
+            _connected = false;
+            boost::system::error_code ignored;
+            _socket.close(ignored);
+        }
+        _alive = false;
+        // the requests that waited for the next connection open it
+        std::deque<std::uint64_t> queued;
+        queued.swap(_queued);
+        for(std::uint64_t id: queued){
+            begin(id);
+        }
+    });
+}
@@ -29,10 +29,29 @@
 #define ARANGOPP_ARANGO_H
 
 #include "tash/connection.h"
+#include "tash/reader.h"
+#include "tash/typed.h"
+#include "tash/pool.h"
+#include "tash/dns.h"
+#include "tash/cluster.h"
+#include "tash/compression.h"
+#include "tash/vpack.h"
+#include "tash/multiplexer.h"
+#include "tash/vst.h"
+#include "tash/hpack.h"
+#include "tash/http2.h"
+#include "tash/executor.h"
+#include "tash/deadline.h"
+#include "tash/retry.h"
+#include "tash/limiter.h"
+#include "tash/tls.h"
+#include "tash/pipeline.h"
+#include "tash/batch.h"
 #include "tash/query.h"
 #include "tash/filter.h"
 #include "tash/filter.h"
 #include "tash/compositor.h"
 #include "tash/ddl.h"
+#include "tash/coroutine.h"
 
 #endif // ARANGOPP_ARANGO_H
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_ASYNC_H
+#define ARANGOPP_ASYNC_H
+
+#include <memory>
+#include <utility>
+#include <functional>
+#include <boost/asio/dispatch.hpp>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/associated_executor.hpp>
+#include <boost/beast/core/bind_handler.hpp>
+#include <boost/asio/detail/config.hpp>
+
+#if defined(BOOST_ASIO_HAS_CO_AWAIT)
+# include <boost/asio/awaitable.hpp>
+# include <boost/asio/use_awaitable.hpp>
+# define TASH_HAS_COROUTINES 1
+/**
+ * with C++20 coroutines the asynchronous operations default to use_awaitable, so that co_await conn.async_aql(q) just works
+ */
+# define TASH_DEFAULT_COMPLETION_TOKEN_TYPE = boost::asio::use_awaitable_t<>
+# define TASH_DEFAULT_COMPLETION_TOKEN = boost::asio::use_awaitable_t<>()
+#else
+# define TASH_DEFAULT_COMPLETION_TOKEN_TYPE
+# define TASH_DEFAULT_COMPLETION_TOKEN
+#endif
+
+namespace tash{
+namespace detail{
+    
+    /**
+     * type erases an asio completion handler so that the asynchronous operations can be implemented out of line
+     * the handler is invoked exactly once on its associated executor and keeps that executor busy until then
+     */
+    template <typename... Args, typename Handler, typename Executor>
+    std::function<void(Args...)> completion(Handler&& handler, const Executor& fallback){
+        typedef typename std::decay<Handler>::type handler_type;
+        auto shared = std::make_shared<handler_type>(std::forward<Handler>(handler));
+        auto work   = boost::asio::make_work_guard(boost::asio::get_associated_executor(*shared, fallback));
+        return [shared, work](Args... args){
+            boost::asio::dispatch(work.get_executor(), boost::beast::bind_front_handler(std::move(*shared), std::move(args)...));
+        };
+    }
+    
+}
+}
+
+#endif // ARANGOPP_ASYNC_H
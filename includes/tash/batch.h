@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_BATCH_H
+#define ARANGOPP_BATCH_H
+
+#include <vector>
+#include "tash/connection.h"
+
+namespace tash{
+    
+    /**
+     * packs many operations into one multipart request to _api/batch and demultiplexes the parts of the answer
+     * 
+     * tash::batch ops(school);
+     * ops.add("_api/document/students", document.dump()).add("_api/document/students/1234");
+     * std::vector<tash::http_response_type> responses = ops.execute();
+     */
+    class batch: boost::noncopyable{
+        connection&                    _conn;
+        std::string                    _boundary;
+        std::vector<http_request_type> _requests;
+      public:
+        explicit batch(connection& conn, const std::string& boundary = "XXXtashbatchpartXXX");
+        batch& add(const http_request_type& request);
+        batch& add(std::string path, boost::beast::http::verb method = boost::beast::http::verb::get);
+        batch& add(std::string path, const std::string& content, std::string type = "application/json", boost::beast::http::verb method = boost::beast::http::verb::post);
+        std::size_t size() const{return _requests.size();}
+        bool empty() const{return _requests.empty();}
+        void clear();
+        /**
+         * the multipart/form-data request carrying all operations added so far
+         */
+        http_request_type request() const;
+        /**
+         * sends the batch and returns one response per operation in the order of add()
+         * operations the server did not answer are reported with status unknown
+         */
+        std::vector<http_response_type> execute();
+        /**
+         * splits a response of _api/batch into the responses of the individual operations
+         */
+        std::vector<http_response_type> demultiplex(const http_response_type& response) const;
+    };
+    
+}
+
+#endif // ARANGOPP_BATCH_H
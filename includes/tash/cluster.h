@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_CLUSTER_H
+#define ARANGOPP_CLUSTER_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include "tash/dns.h"
+#include "tash/pool.h"
+#include "tash/vst.h"
+#include "tash/http2.h"
+#include "tash/limiter.h"
+
+namespace tash{
+    
+    /**
+     * address of a server or coordinator, e.g. tcp://localhost:8529, http://10.0.0.1:8529, [::1]:8529
+     * the scheme vst:// selects VelocyStream instead of HTTP, h2:// HTTP/2, ssl:// HTTP over TLS and unix:///tmp/arangodb.sock a unix domain socket on the local host
+     */
+    struct endpoint{
+        std::string _scheme;
+        std::string _host;
+        unsigned    _port;
+        
+        endpoint(const std::string& host, unsigned port);
+        /**
+         * parses an endpoint string as reported by _api/cluster/endpoints, throws std::invalid_argument for unsupported schemes
+         */
+        static endpoint parse(const std::string& str);
+        std::string scheme() const{return _scheme;}
+        std::string host() const{return _host;}
+        unsigned port() const{return _port;}
+        /**
+         * true for unix domain sockets, whose path is kept in host()
+         */
+        bool local() const{return _scheme == "unix";}
+        bool secure() const{return _scheme == "ssl";}
+        /**
+         * "vst", "h2" or "http", all endpoints of a connection share one
+         */
+        std::string transport() const;
+        std::string to_string() const;
+        bool operator==(const endpoint& other) const;
+    };
+    
+    /**
+     * a coordinator together with its keep-alive pool, its cached addresses and the counters used for load balancing
+     */
+    class node: boost::noncopyable{
+      public:
+        typedef std::chrono::steady_clock clock_type;
+        
+        struct statistics{
+            std::string               endpoint;
+            bool                      healthy;
+            std::size_t               outstanding;
+            std::size_t               requests;
+            std::size_t               failures;
+            std::chrono::microseconds latency;
+            std::size_t               limit;
+            std::size_t               rejected;
+            tash::breaker::state      circuit;
+        };
+      private:
+        mutable boost::mutex      _mutex;
+        tash::endpoint            _endpoint;
+        tash::dns_cache           _dns;
+        tash::pool                _pool;
+        boost::shared_ptr<tash::multiplexer> _stream;
+        boost::shared_ptr<tash::tls> _tls;
+        std::atomic<std::size_t>  _outstanding;
+        bool                      _healthy;
+        clock_type::time_point    _quarantine;
+        double                    _latency;
+        std::size_t               _requests;
+        std::size_t               _failures;
+        tash::limiter             _limiter;
+        tash::breaker             _breaker;
+      public:
+        node(boost::asio::io_context& io, const tash::endpoint& ep);
+        const tash::endpoint& endpoint() const{return _endpoint;}
+        tash::dns_cache& dns(){return _dns;}
+        tash::pool& pool(){return _pool;}
+        /**
+         * the multiplexed VelocyStream or HTTP/2 connection of a vst:// or h2:// node, null for HTTP/1.1 nodes
+         */
+        boost::shared_ptr<tash::multiplexer> stream() const{return _stream;}
+        void stream(boost::shared_ptr<tash::multiplexer> s){_stream = s;}
+        /**
+         * the TLS settings and session of an ssl:// node, null for other nodes
+         */
+        boost::shared_ptr<tash::tls> tls() const{return _tls;}
+        void tls(boost::shared_ptr<tash::tls> t){_tls = t;}
+        /**
+         * caps the requests in flight to the node, disabled by default
+         */
+        tash::limiter& limiter(){return _limiter;}
+        /**
+         * fails requests to the node fast while it keeps failing, disabled by default
+         */
+        tash::breaker& breaker(){return _breaker;}
+        /**
+         * false if the last health check failed, a request failed to reach the node within the quarantine period or the circuit is open
+         */
+        bool available() const;
+        void healthy(bool flag);
+        /**
+         * takes the node out of rotation for the given period after it could not be reached
+         */
+        void quarantine(clock_type::duration period);
+        std::size_t outstanding() const{return _outstanding;}
+        /**
+         * exponentially weighted moving average of the request latency, zero until the first request completes
+         */
+        std::chrono::microseconds latency() const;
+        /**
+         * admits a request, fails with boost::asio::error::host_unreachable while the circuit is open and with try_again at the concurrency limit
+         * every admitted request has to be completed with end()
+         */
+        boost::system::error_code begin();
+        /**
+         * completes a request, one that is not counted (e.g. cancelled by the caller) does not affect the limit and the circuit
+         */
+        void end(clock_type::duration elapsed, bool success, bool counted = true);
+        statistics stats() const;
+    };
+    
+    typedef boost::shared_ptr<node> node_ptr;
+    
+    /**
+     * chooses the coordinator for each request among the available nodes
+     * if no node is available all of them are considered, so that a cluster recovers without health checks
+     */
+    class balancer: boost::noncopyable{
+      public:
+        enum class policy{
+            round_robin,
+            least_outstanding,
+            latency_weighted
+        };
+      private:
+        mutable boost::mutex     _mutex;
+        std::vector<node_ptr>    _nodes;
+        policy                   _policy;
+        node::clock_type::duration _quarantine;
+        std::atomic<std::size_t> _next;
+      public:
+        balancer();
+        policy balancing() const;
+        balancer& balancing(policy p);
+        /**
+         * configures the concurrency limiter or the circuit breaker of every node, nodes discovered later are configured like the first one
+         */
+        balancer& limiting(const tash::limiter::settings& s);
+        balancer& breaking(const tash::breaker::settings& s);
+        /**
+         * how long a coordinator that could not be reached is skipped, 5 seconds by default
+         */
+        node::clock_type::duration quarantine() const;
+        balancer& quarantine(node::clock_type::duration period);
+        /**
+         * adds a node unless one with the same endpoint exists, returns the node for the endpoint
+         */
+        node_ptr add(boost::asio::io_context& io, const tash::endpoint& ep);
+        std::vector<node_ptr> nodes() const;
+        /**
+         * picks a node according to the policy, skipping the ones in excluded, returns null if there is none left
+         */
+        node_ptr pick(const std::vector<node_ptr>& excluded = std::vector<node_ptr>());
+    };
+    
+}
+
+#endif // ARANGOPP_CLUSTER_H
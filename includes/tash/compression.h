@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_COMPRESSION_H
+#define ARANGOPP_COMPRESSION_H
+
+#include <string>
+#include <cstddef>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+namespace tash{
+    
+    /**
+     * opt-in HTTP compression of a connection, requires tash to be built with zlib
+     */
+    struct compression{
+        /**
+         * sends Accept-Encoding: gzip, deflate so that the server may compress its responses
+         */
+        bool        accept;
+        /**
+         * request bodies of at least threshold bytes are sent gzip encoded, 0 never compresses
+         */
+        std::size_t threshold;
+        /**
+         * zlib compression level, -1 is the zlib default
+         */
+        int         level;
+        
+        explicit compression(bool accept = false, std::size_t threshold = 0, int level = -1);
+        /**
+         * whether tash was built with zlib
+         */
+        static bool available();
+    };
+    
+    /**
+     * gzip encodes content
+     */
+    std::string gzip(boost::beast::string_view content, int level = -1);
+    /**
+     * replaces the body of a response sent with Content-Encoding gzip or deflate by its decoded form,
+     * the body buffers are inflated one after the other without being flattened first
+     * returns false if the response was not encoded
+     */
+    bool decode(boost::beast::http::response<boost::beast::http::dynamic_body>& response);
+    
+}
+
+#endif // ARANGOPP_COMPRESSION_H
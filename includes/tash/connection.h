@@ -28,6 +28,12 @@
 #ifndef ARANGOPP_CONNECTION_H
 #define ARANGOPP_CONNECTION_H
 
+#include <atomic>
+#include <utility>
+#include <iterator>
+#include <stdexcept>
+#include <functional>
+#include <initializer_list>
 #include <boost/asio.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/beast/core.hpp>
@@ -36,8 +42,17 @@
 #include <boost/lexical_cast.hpp>
 #include <nlohmann/json.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include "filter.h"
+#include "cluster.h"
+#include "compression.h"
+#include "vpack.h"
+#include "executor.h"
+#include "deadline.h"
+#include "retry.h"
+#include "async.h"
 
 namespace tash{
     typedef boost::beast::http::request<boost::beast::http::string_body>    http_request_type;
@@ -47,10 +62,73 @@ namespace tash{
     class shell;
     class collection;
     class cursor;
+    template <typename T>
+    class typed_cursor;
+    
+namespace detail{
+    
+    /**
+     * input iterator over the documents of all remaining batches of a cursor, stepping past the last document of a batch fetches the next one
+     * each fetch replaces the batch, so no more than one batch is held however many documents are iterated
+     * CursorT provides batch_size(), element(), has_more(), fetch(), failed() and code()
+     */
+    template <typename CursorT, typename ValueT>
+    class batch_iterator{
+        CursorT*    _cursor;
+        std::size_t _index;
+      public:
+        typedef std::input_iterator_tag                     iterator_category;
+        typedef typename std::remove_const<ValueT>::type    value_type;
+        typedef std::ptrdiff_t                              difference_type;
+        typedef ValueT*                                     pointer;
+        typedef ValueT&                                     reference;
+        
+        batch_iterator(): _cursor(nullptr), _index(0){}
+        explicit batch_iterator(CursorT* c): _cursor(c), _index(0){
+            if(_cursor->failed()){
+                // a query that failed up front would otherwise iterate no documents
+                fail();
+            }
+            settle();
+        }
+        reference operator*() const{return _cursor->element(_index);}
+        pointer operator->() const{return &_cursor->element(_index);}
+        batch_iterator& operator++(){
+            ++_index;
+            settle();
+            return *this;
+        }
+        void operator++(int){++*this;}
+        bool operator==(const batch_iterator& other) const{return _cursor == other._cursor && _index == other._index;}
+        bool operator!=(const batch_iterator& other) const{return !(*this == other);}
+      private:
+        void settle(){
+            while(_cursor && _index >= _cursor->batch_size()){
+                if(!_cursor->has_more()){
+                    _cursor = nullptr;
+                    _index  = 0;
+                    return;
+                }
+                _cursor->fetch();
+                if(_cursor->failed()){
+                    // ending here would look like the last document had been reached
+                    fail();
+                }
+                _index = 0;
+            }
+        }
+        void fail() const{
+            throw std::runtime_error("cursor fetch failed with code "+std::to_string(_cursor->code()));
+        }
+    };
+    
+}
     
     class cursor{
         friend class connection;
         friend class shell;
+        template <typename T>
+        friend class typed_cursor;
         
         mutable boost::mutex _mutex;
         connection&     _conn;
@@ -59,80 +137,449 @@ namespace tash{
         bool            _error;
         int             _count;
         int             _code;
-        nlohmann::json  _results;
+        /**
+         * the current batch, replaced by the next one rather than modified so that snapshots stay valid, null once the cursor was moved from
+         */
+        boost::shared_ptr<nlohmann::json> _results;
+        node_ptr        _node;
+        std::string     _batch;
+        class prefetcher;
+        boost::shared_ptr<prefetcher> _prefetcher;
+      public:
+        /**
+         * receives the documents of a batch one at a time while the response is parsed, it may move from the document
+         */
+        typedef std::function<void(nlohmann::json& document)> visitor_type;
+      private:
+        visitor_type    _visitor;
       public:
+        /**
+         * input iterator over the documents of all remaining batches, stepping past the last document of a batch fetches the next one
+         * each fetch replaces the batch, so no more than one batch is held however many documents are iterated
+         * throws what fetch() throws, and std::runtime_error if the server fails to deliver a batch
+         */
+        typedef detail::batch_iterator<cursor, const nlohmann::json> iterator;
+        
         cursor(connection& conn, const std::string& id);
+        /**
+         * copies share the current batch instead of copying it
+         */
         cursor(const cursor& other);
+        /**
+         * takes over the batch, the prefetched batches and the visitor, the moved from cursor has no batch and nothing more to fetch
+         */
+        cursor(cursor&& other);
+        /**
+         * iterates from the first document of the current batch, e.g. for(const nlohmann::json& document: cursor){ ... }
+         * a cursor is iterated by one thread at a time, and only once as the batches are fetched along the way
+         */
+        iterator begin(){return iterator(this);}
+        iterator end(){return iterator();}
         void fetch();
+        /**
+         * fetches the next batch asynchronously, the cursor must outlive the operation
+         * completion signature void(boost::system::error_code)
+         */
+        template <typename CompletionToken TASH_DEFAULT_COMPLETION_TOKEN_TYPE>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code)) async_fetch(CompletionToken&& token TASH_DEFAULT_COMPLETION_TOKEN);
+        /**
+         * fetches up to depth batches ahead on a thread of its own while the current one is processed, fetch() then takes the next batch without waiting for the coordinator
+         * the batches follow one another, so one request is in flight at a time, copies of the cursor share the batches fetched ahead
+         * throws std::invalid_argument for a depth of 0
+         */
+        cursor& prefetch(std::size_t depth = 2);
+        /**
+         * streams the documents of the batches fetched from now on to the visitor instead of keeping them in results(), has_more(), count() and the like are kept as usual
+         * a JSON batch is never held as a whole, only the document being parsed, the visitor must not call back into the cursor and runs on the prefetch thread with prefetch()
+         * batches prefetched before visit() was called are handed to the visitor by the fetch() that takes them
+         */
+        cursor& visit(visitor_type visitor);
         bool has_more() const{return _has_more;}
         bool error() const{return _error;}
         int count() const{return _count;}
         int code() const {return _code;}
+        /**
+         * a copy of the current batch, snapshot() and take_results() avoid the copy
+         */
         nlohmann::json results() const;
+        /**
+         * the current batch shared with the cursor, it stays valid and unchanged while the cursor moves on to the next batch
+         */
+        boost::shared_ptr<const nlohmann::json> snapshot() const;
+        /**
+         * moves the current batch out of the cursor, which is left with an empty one
+         * the batch is only copied if a copy of the cursor or a snapshot still shares it
+         */
+        nlohmann::json take_results();
+        /**
+         * the coordinator that holds the cursor, all batches are fetched from it
+         */
+        node_ptr coordinator() const{return _node;}
+        /**
+         * id of the next batch if the cursor was created with retries enabled, fetching it can then be retried safely
+         */
+        std::string next_batch() const{return _batch;}
       private:
         cursor(connection& conn);
+        /**
+         * the current batch, null if there is none
+         */
+        const nlohmann::json& current() const;
+        template <typename CursorT, typename ValueT>
+        friend class detail::batch_iterator;
+        std::size_t batch_size() const{return current().size();}
+        const nlohmann::json& element(std::size_t index) const{return current()[index];}
+        bool failed() const{return _error || !current().is_array();}
+        http_request_type next() const;
+        tash::request_options next_options() const;
         void attach(const http_response_type& response);
+        /**
+         * takes the metadata of a cursor response parsed into json
+         */
+        void adopt(nlohmann::json& json);
+        void start_fetch(std::function<void(boost::system::error_code)> handler);
       public:
         ~cursor();
     };
     
     class connection: boost::noncopyable{
+        friend class cursor;
+        friend class pipeline;
+        template <typename T>
+        friend class typed_cursor;
       private:
-        boost::mutex                    _mutex;
-        boost::asio::io_context         _io;
-        boost::asio::ip::tcp::resolver  _resolver;
+        boost::shared_ptr<tash::executor> _executor;
+        boost::asio::io_context&        _io;
+        tash::balancer                  _balancer;
+        node_ptr                        _primary;
+        boost::thread                   _health;
+        /**
+         * aborts the probe in flight when the health checks are stopped
+         */
+        tash::cancellation              _health_token;
+        boost::thread                   _renewal;
+        /**
+         * aborts the login of the renewal thread when it is stopped
+         */
+        tash::cancellation              _renewal_token;
+        mutable boost::mutex            _auth_mutex;
+        boost::mutex                    _login_mutex;
+        /**
+         * requests rejected with 401 while an asynchronous login is under way wait for its outcome instead of logging in themselves
+         */
+        boost::mutex                    _relogin_mutex;
+        std::vector<std::function<void(bool)>> _relogins;
 
         std::string _host;
         unsigned    _port;
         std::string _user;
         std::string _pass;
         std::string _db;
+        tash::compression _compression;
+        bool        _velocypack;
+        tash::timeouts _timeouts;
+        tash::retry_policy _retry;
+        tash::retry_budget _budget;
+        std::string _token;
+        std::chrono::system_clock::time_point _expiry;
+        std::atomic<bool> _bearer;
+        boost::shared_ptr<const std::string> _authorization;
+        std::string _prefix;
+        boost::shared_ptr<const std::string> _preamble;
+        boost::shared_ptr<boost::asio::ssl::context> _tls;
       public:
         connection(const std::string& db, std::string host = "localhost", unsigned port = 8529, std::string user = "root", std::string pass = "");
+        /**
+         * connection to several coordinators of a cluster, e.g. {"tcp://coordinator1:8529", "tcp://coordinator2:8529"}
+         * with vst:// endpoints, e.g. {"vst://localhost:8529"}, requests are multiplexed over VelocyStream instead of HTTP, all endpoints have to use the same transport
+         * h2:// endpoints, e.g. {"h2://localhost:8529"}, multiplex the requests over one HTTP/2 connection per coordinator
+         * ssl:// endpoints, e.g. {"ssl://coordinator1:8530"}, use HTTP over TLS
+         */
+        connection(const std::string& db, const std::vector<std::string>& endpoints, std::string user = "root", std::string pass = "");
+        /**
+         * connections that run their asynchronous operations on a shared executor
+         */
+        connection(boost::shared_ptr<tash::executor> executor, const std::string& db, std::string host = "localhost", unsigned port = 8529, std::string user = "root", std::string pass = "");
+        connection(boost::shared_ptr<tash::executor> executor, const std::string& db, const std::vector<std::string>& endpoints, std::string user = "root", std::string pass = "");
+        ~connection();
         std::string host() const{return _host;}
         unsigned    port() const{return _port;}
         std::string username() const{return _user;}
         std::string password() const{return _pass;}
         std::string database() const{return _db;}
+        /**
+         * the io_context the asynchronous operations are executed on, it has to be run by the caller
+         */
+        boost::asio::io_context& io(){return _io;}
+        /**
+         * the executor running io(), it has no workers unless it was shared at construction or threads() was called
+         */
+        boost::shared_ptr<tash::executor> executor() const{return _executor;}
+        /**
+         * runs io() on the given number of additional worker threads, from then on completions are dispatched on the workers and io().run() must not be called
+         */
+        connection& threads(std::size_t count);
+        /**
+         * keep-alive channels of the first coordinator, exposes the pool size, idle timeout and hit/miss counters
+         * nodes discovered or added later are configured like the first one
+         */
+        tash::pool& pool(){return _primary->pool();}
+        /**
+         * cached addresses of the first coordinator, exposes the ttl and refresh()
+         */
+        tash::dns_cache& dns(){return _primary->dns();}
+        /**
+         * the coordinators requests are distributed over and the balancing policy
+         */
+        tash::balancer& balancer(){return _balancer;}
+        /**
+         * the HTTP compression settings, nothing is compressed by default
+         */
+        const tash::compression& compression() const{return _compression;}
+        /**
+         * enables Accept-Encoding and gzip encoding of request bodies above the threshold, throws std::logic_error if tash was built without zlib
+         * meant to be called before requests are made
+         */
+        connection& compression(const tash::compression& settings);
+        /**
+         * whether documents are exchanged as VelocyPack instead of JSON text
+         */
+        bool velocypack() const{return _velocypack;}
+        /**
+         * asks the server to answer in application/x-velocypack and makes serialize() produce VelocyPack
+         * meant to be called before requests are made
+         */
+        connection& velocypack(bool enabled);
+        /**
+         * the TLS context of the ssl:// endpoints, null if there are none
+         * it verifies the server against the system's certificate authorities, e.g. load_verify_file() adds a private one
+         */
+        boost::shared_ptr<boost::asio::ssl::context> tls() const{return _tls;}
+        /**
+         * replaces the TLS context of the ssl:// endpoints, idle sockets and sessions established with the previous one are dropped
+         * meant to be called before requests are made
+         */
+        connection& tls(boost::shared_ptr<boost::asio::ssl::context> context);
+        /**
+         * the timeouts of requests made without request_options, unlimited by default
+         */
+        const tash::timeouts& timeouts() const{return _timeouts;}
+        /**
+         * meant to be called before requests are made
+         */
+        connection& timeouts(const tash::timeouts& limits);
+        /**
+         * how failed requests are retried, by default they are not
+         */
+        const tash::retry_policy& retries() const{return _retry;}
+        /**
+         * sets the policy and refills the retry budget, meant to be called before requests are made
+         */
+        connection& retries(const tash::retry_policy& policy);
+        /**
+         * retries left in the budget
+         */
+        double retry_budget() const{return _budget.tokens();}
+        /**
+         * replaces HTTP Basic authentication by a JSON web token obtained from /_open/auth, so the server does not check the password on every request
+         * the token is renewed in the background renew before it expires and right away if the server rejects it, the rejected request is then sent once more
+         * throws std::runtime_error if the login is refused and std::logic_error for VelocyStream connections, which authenticate once per socket anyway
+         */
+        connection& jwt(std::chrono::seconds renew = std::chrono::seconds(60));
+        /**
+         * the current JSON web token, empty unless jwt() was called
+         */
+        std::string token() const;
+        /**
+         * a document in the wire format of the connection, to be sent with content_type()
+         */
+        std::string serialize(const nlohmann::json& document) const;
+        std::string content_type() const;
+        /**
+         * the body of a response, decoded as VelocyPack if the server answered with application/x-velocypack and parsed as JSON text otherwise
+         */
+        static nlohmann::json parse(const http_response_type& response);
+        /**
+         * adds the coordinators listed by _api/cluster/endpoints, returns the number of known coordinators
+         */
+        std::size_t discover();
+        /**
+         * checks every coordinator with _api/version and updates its health, a coordinator that does not answer within 5 seconds counts as unhealthy
+         */
+        void probe();
+        /**
+         * probe() bounded by the given timeouts per coordinator and cancellable through the token of the options
+         */
+        void probe(const tash::request_options& options);
+        /**
+         * runs probe() in the background every interval, a zero interval stops the health checks
+         */
+        void health_checks(std::chrono::milliseconds interval);
         
         http_request_type url(boost::beast::http::verb method = boost::beast::http::verb::get, std::string path = "") const;
         http_request_type db_url(boost::beast::http::verb method = boost::beast::http::verb::get, std::string path = "") const;
+        /**
+         * builds a request for a path, absolute paths (starting with /) are server wide, others are relative to the database
+         */
+        http_request_type request(std::string path, boost::beast::http::verb method = boost::beast::http::verb::get) const;
+        http_request_type request(std::string path, std::string content, std::string type = "application/json", boost::beast::http::verb method = boost::beast::http::verb::post) const;
         
         boost::beast::http::status exists();
         boost::beast::http::status create();
         
         http_response_type query(const http_request_type& request);
+        /**
+         * sends the request to target if it is set, otherwise to the coordinator chosen by the balancer which is then stored in target
+         */
+        http_response_type query(const http_request_type& request, node_ptr& target);
+        /**
+         * query() bounded by the given timeouts and cancellable through the token of the options
+         * throws boost::system::system_error with boost::asio::error::timed_out or operation_aborted, the socket of such a request is closed
+         */
+        http_response_type query(const http_request_type& request, const tash::request_options& options);
+        http_response_type query(const http_request_type& request, node_ptr& target, const tash::request_options& options);
         http_response_type query(std::string path, boost::beast::http::verb method = boost::beast::http::verb::get);
-        http_response_type query(std::string path, const std::string& content, std::string type = "application/json", boost::beast::http::verb method = boost::beast::http::verb::post);
+        http_response_type query(std::string path, std::string content, std::string type = "application/json", boost::beast::http::verb method = boost::beast::http::verb::post);
+        /**
+         * sends a request without building an http_request_type, e.g. send(verb::get, {"_api/document/", collection, "/", key})
+         * the path segments are joined behind the precomputed database prefix in a per thread buffer together with the precomputed Host and Authorization lines,
+         * head and content are written with a single scatter-gather write so the content is never copied
+         */
+        http_response_type send(boost::beast::http::verb method, std::initializer_list<boost::beast::string_view> path, boost::beast::string_view content = boost::beast::string_view(), boost::beast::string_view type = "application/json");
         cursor aql(const std::string& q, int count = 0, int batch = 0);
         template <typename AqlT>
         cursor aql(const AqlT& q, int count = 0, int batch = 0){
             std::string query = boost::lexical_cast<std::string>(q);
             return aql(query, count, batch);
         }
+        /**
+         * aql() that streams the documents of the first batch and all the following ones to the visitor, see cursor::visit()
+         */
+        cursor aql(const std::string& q, cursor::visitor_type visitor, int count = 0, int batch = 0);
+        template <typename AqlT>
+        cursor aql(const AqlT& q, cursor::visitor_type visitor, int count = 0, int batch = 0){
+            std::string query = boost::lexical_cast<std::string>(q);
+            return aql(query, std::move(visitor), count, batch);
+        }
+      public:
+        /**
+         * asynchronous counterpart of query(), completion signature void(boost::system::error_code, http_response_type)
+         * the completion token may be a callback, boost::asio::use_future or boost::asio::use_awaitable
+         */
+        template <typename CompletionToken TASH_DEFAULT_COMPLETION_TOKEN_TYPE>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, http_response_type)) async_query(const http_request_type& request, CompletionToken&& token TASH_DEFAULT_COMPLETION_TOKEN){
+            return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code, http_response_type)>([this](auto handler, const http_request_type& request){
+                start_query(request, detail::completion<boost::system::error_code, http_response_type>(std::move(handler), _io.get_executor()));
+            }, token, request);
+        }
+        /**
+         * async_query() bounded by the given timeouts and cancellable through the token of the options
+         */
+        template <typename CompletionToken TASH_DEFAULT_COMPLETION_TOKEN_TYPE>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, http_response_type)) async_query(const http_request_type& request, const tash::request_options& options, CompletionToken&& token TASH_DEFAULT_COMPLETION_TOKEN){
+            return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code, http_response_type)>([this](auto handler, const http_request_type& request, const tash::request_options& options){
+                start_query(request, tash::node_ptr(), options, [handler = detail::completion<boost::system::error_code, http_response_type>(std::move(handler), _io.get_executor())](boost::system::error_code ec, http_response_type response, node_ptr){
+                    handler(ec, std::move(response));
+                });
+            }, token, request, options);
+        }
+        /**
+         * asynchronous counterpart of aql(), completion signature void(boost::system::error_code, cursor)
+         */
+        template <typename CompletionToken TASH_DEFAULT_COMPLETION_TOKEN_TYPE>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, cursor)) async_aql(const std::string& q, int count, int batch, CompletionToken&& token TASH_DEFAULT_COMPLETION_TOKEN){
+            return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code, cursor)>([this](auto handler, const std::string& q, int count, int batch){
+                start_aql(q, count, batch, detail::completion<boost::system::error_code, cursor>(std::move(handler), _io.get_executor()));
+            }, token, q, count, batch);
+        }
+        template <typename AqlT, typename CompletionToken TASH_DEFAULT_COMPLETION_TOKEN_TYPE>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, cursor)) async_aql(const AqlT& q, CompletionToken&& token TASH_DEFAULT_COMPLETION_TOKEN){
+            return async_aql(boost::lexical_cast<std::string>(q), 0, 0, std::forward<CompletionToken>(token));
+        }
+      private:
+        void prepare();
+        http_request_type credentials() const;
+        /**
+         * takes the token from a response of /_open/auth, false if the login was refused
+         */
+        bool renew(const http_response_type& response);
+        void login(const tash::request_options& options);
+        /**
+         * renews the token after the server rejected used, false if JWT is not in use or the login fails
+         */
+        bool reauthenticate(boost::beast::string_view used);
+        std::string authorization() const;
+        node_ptr join(const tash::endpoint& ep);
+        void connect(tash::node& target, tash::channel& ch, const tash::deadline& deadline);
+        tash::pool::channel_ptr checkout(tash::node& target, bool& reused, const tash::deadline& deadline);
+        template <typename MessageT>
+        http_response_type deliver(const MessageT& message, node_ptr& target, const tash::request_options& options, bool idempotent);
+        template <typename MessageT>
+        http_response_type transmit(const MessageT& message, node_ptr& target, const tash::deadline& deadline, bool& sent);
+        template <typename MessageT>
+        http_response_type transfer(tash::node& target, tash::pool::channel_ptr ch, bool reused, const MessageT& message, const tash::deadline& deadline);
+        /**
+         * the POST of a query to _api/cursor
+         */
+        http_request_type aql_request(const std::string& q, int count, int batch) const;
+        cursor open(const std::string& q, const http_response_type& response, const node_ptr& target, cursor::visitor_type visitor = cursor::visitor_type());
+        void start_query(const http_request_type& request, std::function<void(boost::system::error_code, http_response_type)> handler);
+        void start_query(const http_request_type& request, node_ptr target, std::function<void(boost::system::error_code, http_response_type, node_ptr)> handler);
+        void start_query(const http_request_type& request, node_ptr target, const tash::request_options& options, std::function<void(boost::system::error_code, http_response_type, node_ptr)> handler);
+        void start_aql(const std::string& q, int count, int batch, std::function<void(boost::system::error_code, cursor)> handler);
     };
     
+    /**
+     * a connection that keeps the cursor of the last query run()
+     * the last cursor is shared by all threads using the shell, threads that run queries concurrently should use submit() instead
+     */
     class shell: public connection{
       boost::shared_ptr<cursor> _last;
+      mutable boost::mutex      _last_mutex;
       public:
         shell(const std::string& db, std::string host = "localhost", unsigned port = 8529, std::string user = "root", std::string pass = "");
+        shell(const std::string& db, const std::vector<std::string>& endpoints, std::string user = "root", std::string pass = "");
+        shell(boost::shared_ptr<tash::executor> executor, const std::string& db, std::string host = "localhost", unsigned port = 8529, std::string user = "root", std::string pass = "");
+        shell(boost::shared_ptr<tash::executor> executor, const std::string& db, const std::vector<std::string>& endpoints, std::string user = "root", std::string pass = "");
       public:
-        bool has_more() const {return _last->has_more();}
-        bool is_error() const {return _last->error();}
-        int count() const {return _last->count();}
-        int code() const {return _last->code();}
-        nlohmann::json results() const{return _last->results();}
+        bool has_more() const {return last()->has_more();}
+        bool is_error() const {return last()->error();}
+        int count() const {return last()->count();}
+        int code() const {return last()->code();}
+        nlohmann::json results() const{return last()->results();}
+        boost::shared_ptr<const nlohmann::json> snapshot() const{return last()->snapshot();}
+        nlohmann::json take_results(){return last()->take_results();}
       public:
         template <typename AqlT>
         shell& run(const AqlT& query){
-            _last = boost::make_shared<cursor>(aql(query));
+            boost::shared_ptr<cursor> c = boost::make_shared<cursor>(aql(query));
+            {
+                boost::mutex::scoped_lock lock(_last_mutex);
+                _last.swap(c);
+            }
+            // the previous cursor is released outside the lock
             return *this;
         }
+        /**
+         * runs the query and returns its cursor without touching the last cursor of the shell
+         */
+        template <typename AqlT>
+        boost::shared_ptr<cursor> submit(const AqlT& query){
+            return boost::make_shared<cursor>(aql(query));
+        }
         template <typename AqlT>
         shell& operator<<(const AqlT& query){
             return run(query);
         }
+        /**
+         * moves the current batch of the last cursor into res, see cursor::take_results()
+         */
         shell& operator>>(nlohmann::json& res);
+      private:
+        /**
+         * the cursor of the last run(), throws std::logic_error if nothing has been run yet
+         */
+        boost::shared_ptr<cursor> last() const;
     };
     
     class collection{
@@ -159,18 +606,73 @@ namespace tash{
         http_response_type replace(const std::string key, const nlohmann::json& document);
         http_response_type read(const std::string key);
         http_response_type read(int limit = 0, int skip = 0);
+      public:
+        /**
+         * asynchronous counterparts of the CRUD methods, each completes with an error code followed by what the synchronous method returns
+         * documents passed by non const reference must outlive the operation
+         */
+        template <typename CompletionToken TASH_DEFAULT_COMPLETION_TOKEN_TYPE>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, boost::beast::http::status)) async_add(const nlohmann::json& document, CompletionToken&& token TASH_DEFAULT_COMPLETION_TOKEN){
+            return initiate<boost::beast::http::status>(token, [this, document](std::function<void(boost::system::error_code, boost::beast::http::status)> handler){
+                start_add(document, nullptr, handler);
+            });
+        }
+        template <typename CompletionToken TASH_DEFAULT_COMPLETION_TOKEN_TYPE>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, boost::beast::http::status)) async_add(nlohmann::json& document, CompletionToken&& token TASH_DEFAULT_COMPLETION_TOKEN){
+            return initiate<boost::beast::http::status>(token, [this, &document](std::function<void(boost::system::error_code, boost::beast::http::status)> handler){
+                start_add(document, &document, handler);
+            });
+        }
+        template <typename CompletionToken TASH_DEFAULT_COMPLETION_TOKEN_TYPE>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, http_response_type)) async_update(const std::string& key, const nlohmann::json& document, CompletionToken&& token TASH_DEFAULT_COMPLETION_TOKEN){
+            return _conn.async_query(_conn.request(document_path(key), _conn.serialize(document), _conn.content_type(), boost::beast::http::verb::patch), std::forward<CompletionToken>(token));
+        }
+        template <typename CompletionToken TASH_DEFAULT_COMPLETION_TOKEN_TYPE>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, http_response_type)) async_replace(const std::string& key, const nlohmann::json& document, CompletionToken&& token TASH_DEFAULT_COMPLETION_TOKEN){
+            return _conn.async_query(_conn.request(document_path(key), _conn.serialize(document), _conn.content_type(), boost::beast::http::verb::put), std::forward<CompletionToken>(token));
+        }
+        template <typename CompletionToken TASH_DEFAULT_COMPLETION_TOKEN_TYPE>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, http_response_type)) async_read(const std::string& key, CompletionToken&& token TASH_DEFAULT_COMPLETION_TOKEN){
+            return _conn.async_query(_conn.request(document_path(key)), std::forward<CompletionToken>(token));
+        }
       protected:
         nlohmann::json by_id(const std::string& id);
         nlohmann::json by_key(const std::string& key);
+        template <typename CompletionToken TASH_DEFAULT_COMPLETION_TOKEN_TYPE>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, nlohmann::json)) async_by_id(const std::string& id, CompletionToken&& token TASH_DEFAULT_COMPLETION_TOKEN){
+            return initiate<nlohmann::json>(token, [this, id](std::function<void(boost::system::error_code, nlohmann::json)> handler){
+                start_by_id(id, handler);
+            });
+        }
+        template <typename CompletionToken TASH_DEFAULT_COMPLETION_TOKEN_TYPE>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, nlohmann::json)) async_by_key(const std::string& key, CompletionToken&& token TASH_DEFAULT_COMPLETION_TOKEN){
+            return async_by_id(_name+"/"+key, std::forward<CompletionToken>(token));
+        }
+      private:
+        std::string document_path(const std::string& key) const;
+        /**
+         * inserts of documents with a _key are idempotent, a retried one may report 409 if the first attempt got through
+         */
+        tash::request_options insert_options(const nlohmann::json& document) const;
+        template <typename T, typename CompletionToken, typename F>
+        BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code, T)) initiate(CompletionToken& token, F start){
+            return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code, T)>([this, start](auto handler){
+                start(detail::completion<boost::system::error_code, T>(std::move(handler), _conn.io().get_executor()));
+            }, token);
+        }
+        void start_add(const nlohmann::json& document, nlohmann::json* target, std::function<void(boost::system::error_code, boost::beast::http::status)> handler);
+        void start_by_id(const std::string& id, std::function<void(boost::system::error_code, nlohmann::json)> handler);
     };
     
     struct vertex: public collection{
         using collection::by_key;
+        using collection::async_by_key;
         vertex(connection& conn, const std::string& name): collection(conn, name, collection::type::vertex){}
     };
     struct edge: public collection{
         using collection::add;
         using collection::by_key;
+        using collection::async_by_key;
         edge(connection& conn, const std::string& name): collection(conn, name, collection::type::edge){}
         boost::beast::http::status add(const std::string& from, const std::string& to, nlohmann::json& document);
         boost::beast::http::status add(const std::string& from, const std::string& to, const nlohmann::json& document);
@@ -178,4 +680,11 @@ namespace tash{
     };
 }
 
+template <typename CompletionToken>
+BOOST_ASIO_INITFN_RESULT_TYPE(CompletionToken, void(boost::system::error_code)) tash::cursor::async_fetch(CompletionToken&& token){
+    return boost::asio::async_initiate<CompletionToken, void(boost::system::error_code)>([this](auto handler){
+        start_fetch(detail::completion<boost::system::error_code>(std::move(handler), _conn.io().get_executor()));
+    }, token);
+}
+
 #endif // ARANGOPP_ARANGO_H
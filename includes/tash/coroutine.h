@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_COROUTINE_H
+#define ARANGOPP_COROUTINE_H
+
+#include "tash/connection.h"
+
+#if defined(TASH_HAS_COROUTINES)
+
+namespace tash{
+    
+    template <typename T>
+    using awaitable = boost::asio::awaitable<T>;
+    
+    /**
+     * consumes a cursor as an asynchronous generator of documents, the next batch is fetched with co_await once the current one is exhausted
+     * 
+     * tash::cursor cursor = co_await school.async_aql(query);
+     * tash::async_documents documents(cursor);
+     * nlohmann::json document;
+     * while(co_await documents.next(document)){ ... }
+     */
+    class async_documents{
+        cursor&        _cursor;
+        nlohmann::json _batch;
+        std::size_t    _index;
+        bool           _started;
+      public:
+        explicit async_documents(cursor& c): _cursor(c), _index(0), _started(false){}
+        awaitable<bool> next(nlohmann::json& document){
+            if(!_started){
+                _batch   = _cursor.take_results();
+                _started = true;
+            }
+            while(_index >= _batch.size()){
+                if(!_cursor.has_more()){
+                    co_return false;
+                }
+                co_await _cursor.async_fetch(boost::asio::use_awaitable);
+                _batch = _cursor.take_results();
+                _index = 0;
+            }
+            document = std::move(_batch[_index++]);
+            co_return true;
+        }
+    };
+    
+}
+
+#endif // TASH_HAS_COROUTINES
+
+#endif // ARANGOPP_COROUTINE_H
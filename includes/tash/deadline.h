@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_DEADLINE_H
+#define ARANGOPP_DEADLINE_H
+
+#include <map>
+#include <chrono>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/optional.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace tash{
+    
+    /**
+     * limits on the phases of a request, zero means no limit
+     */
+    struct timeouts{
+        /**
+         * establishing the TCP connection
+         */
+        std::chrono::milliseconds connect;
+        /**
+         * sending the request
+         */
+        std::chrono::milliseconds write;
+        /**
+         * from the request being sent until the response starts to arrive
+         */
+        std::chrono::milliseconds first_byte;
+        /**
+         * the whole request including connecting, bounds all of the above
+         */
+        std::chrono::milliseconds total;
+        
+        explicit timeouts(std::chrono::milliseconds total = std::chrono::milliseconds(0), std::chrono::milliseconds connect = std::chrono::milliseconds(0), std::chrono::milliseconds write = std::chrono::milliseconds(0), std::chrono::milliseconds first_byte = std::chrono::milliseconds(0));
+    };
+    
+    /**
+     * token through which a request can be cancelled from another thread, copies share the same state
+     */
+    class cancellation{
+        struct state{
+            boost::mutex                                 _mutex;
+            bool                                         _cancelled;
+            std::size_t                                  _next;
+            std::map<std::size_t, std::function<void()>> _callbacks;
+        };
+        boost::shared_ptr<state> _state;
+      public:
+        cancellation();
+        /**
+         * cancels the requests using the token, they fail with boost::asio::error::operation_aborted
+         */
+        void cancel();
+        bool cancelled() const;
+        /**
+         * calls callback once the token is cancelled, right away if it already is, returns an id for unsubscribe()
+         */
+        std::size_t subscribe(std::function<void()> callback) const;
+        void unsubscribe(std::size_t id) const;
+    };
+    
+    /**
+     * per request timeouts, cancellation and retry safety, requests without options use the timeouts of the connection
+     */
+    struct request_options{
+        tash::timeouts                        timeouts;
+        boost::optional<tash::cancellation>   token;
+        /**
+         * whether the request may be retried after it reached the server, by default only GET, HEAD and OPTIONS requests are
+         */
+        boost::optional<bool>                 idempotent;
+        
+        request_options();
+        request_options(const tash::timeouts& limits);
+        request_options(const tash::timeouts& limits, const tash::cancellation& cancel);
+    };
+    
+    /**
+     * the points in time by which the phases of one request have to complete, measured from its construction
+     */
+    class deadline{
+      public:
+        typedef std::chrono::steady_clock clock_type;
+      private:
+        tash::request_options   _options;
+        clock_type::time_point  _total;
+      public:
+        explicit deadline(const tash::request_options& options);
+        clock_type::time_point total() const{return _total;}
+        /**
+         * the deadline of a phase starting now, the earlier of now + limit and the total deadline
+         */
+        clock_type::time_point phase(std::chrono::milliseconds limit) const;
+        const tash::timeouts& timeouts() const{return _options.timeouts;}
+        const tash::cancellation* token() const{return _options.token ? _options.token.get_ptr() : nullptr;}
+        /**
+         * operation_aborted if the request has been cancelled, timed_out if the deadline has passed, success otherwise
+         */
+        boost::system::error_code check(clock_type::time_point limit) const;
+    };
+    
+    /**
+     * blocks until the socket is readable (or writable), the limit passes or the token is cancelled
+     */
+    void wait(boost::asio::generic::stream_protocol::socket& socket, bool writable, const tash::deadline& deadline, deadline::clock_type::time_point limit, boost::system::error_code& ec);
+    /**
+     * connects the socket to the endpoint within the connect timeout
+     */
+    void connect(boost::asio::generic::stream_protocol::socket& socket, const boost::asio::generic::stream_protocol::endpoint& endpoint, const tash::deadline& deadline, boost::system::error_code& ec);
+    
+    /**
+     * synchronous stream over a connected socket whose reads and writes fail with timed_out or operation_aborted
+     * instead of blocking past the deadline, the socket is non blocking while the stream exists
+     */
+    class deadline_stream{
+        typedef deadline::clock_type clock_type;
+        
+        boost::asio::generic::stream_protocol::socket& _socket;
+        const tash::deadline&           _deadline;
+        clock_type::time_point          _write;
+        clock_type::time_point          _read;
+        bool                            _writing;
+        bool                            _reading;
+        bool                            _received;
+      public:
+        deadline_stream(boost::asio::generic::stream_protocol::socket& socket, const tash::deadline& deadline);
+        ~deadline_stream();
+        
+        template <typename ConstBufferSequence>
+        std::size_t write_some(const ConstBufferSequence& buffers, boost::system::error_code& ec){
+            if(!_writing){
+                _writing = true;
+                _write = _deadline.phase(_deadline.timeouts().write);
+            }
+            while(true){
+                std::size_t bytes = _socket.write_some(buffers, ec);
+                if(ec != boost::asio::error::would_block){
+                    return bytes;
+                }
+                tash::wait(_socket, true, _deadline, _write, ec);
+                if(ec){
+                    return 0;
+                }
+            }
+        }
+        template <typename ConstBufferSequence>
+        std::size_t write_some(const ConstBufferSequence& buffers){
+            boost::system::error_code ec;
+            std::size_t bytes = write_some(buffers, ec);
+            if(ec){
+                throw boost::system::system_error(ec);
+            }
+            return bytes;
+        }
+        template <typename MutableBufferSequence>
+        std::size_t read_some(const MutableBufferSequence& buffers, boost::system::error_code& ec){
+            if(!_reading){
+                _reading = true;
+                _read = _deadline.phase(_deadline.timeouts().first_byte);
+            }
+            while(true){
+                std::size_t bytes = _socket.read_some(buffers, ec);
+                if(ec != boost::asio::error::would_block){
+                    if(bytes > 0){
+                        _received = true;
+                    }
+                    return bytes;
+                }
+                tash::wait(_socket, false, _deadline, _received ? _deadline.total() : _read, ec);
+                if(ec){
+                    return 0;
+                }
+            }
+        }
+        template <typename MutableBufferSequence>
+        std::size_t read_some(const MutableBufferSequence& buffers){
+            boost::system::error_code ec;
+            std::size_t bytes = read_some(buffers, ec);
+            if(ec){
+                throw boost::system::system_error(ec);
+            }
+            return bytes;
+        }
+    };
+    
+}
+
+#endif // ARANGOPP_DEADLINE_H
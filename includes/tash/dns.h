@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_DNS_H
+#define ARANGOPP_DNS_H
+
+#include <chrono>
+#include <vector>
+#include <functional>
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace tash{
+    
+    /**
+     * caches every address a host resolves to for ttl(), so that requests do not go through the resolver
+     * the address that last accepted a connection is handed out first, failed ones are rotated to the back
+     * when the ttl expires and the name cannot be resolved, the stale addresses are used until a resolution succeeds
+     */
+    class dns_cache: boost::noncopyable{
+      public:
+        typedef std::chrono::steady_clock clock_type;
+        /**
+         * a TCP address or the path of a unix domain socket
+         */
+        typedef boost::asio::generic::stream_protocol::endpoint endpoint_type;
+        typedef std::function<void(boost::system::error_code, std::vector<endpoint_type>)> endpoints_handler;
+      private:
+        /**
+         * lets an asynchronous resolution that completes after the cache is gone find out
+         */
+        struct lifeline{
+            boost::mutex    mutex;
+            dns_cache*      cache;
+        };
+        mutable boost::mutex            _mutex;
+        boost::mutex                    _resolving;
+        boost::asio::ip::tcp::resolver  _resolver;
+        std::string                     _host;
+        std::string                     _service;
+        std::vector<endpoint_type>      _endpoints;
+        clock_type::time_point          _expiry;
+        clock_type::duration            _ttl;
+        std::size_t                     _resolutions;
+        bool                            _pinned;
+        bool                            _refreshing;
+        std::vector<endpoints_handler>  _waiting;
+        boost::shared_ptr<lifeline>     _lifeline;
+      public:
+        dns_cache(boost::asio::io_context& io, const std::string& host, unsigned port, clock_type::duration ttl = std::chrono::seconds(60));
+        ~dns_cache();
+        std::string host() const{return _host;}
+        clock_type::duration ttl() const;
+        dns_cache& ttl(clock_type::duration duration);
+        /**
+         * the cached addresses in the order they should be tried, resolves the host if the cache is empty or expired
+         * while one thread resolves an expired host, the others are served the stale addresses instead of waiting
+         */
+        std::vector<endpoint_type> endpoints();
+        /**
+         * endpoints() for the io threads, never blocks on the resolver: an expired host is refreshed with async_resolve in the background while the stale addresses are served
+         * the handler only waits for the resolution if nothing is cached, otherwise it is called before async_endpoints() returns
+         */
+        void async_endpoints(endpoints_handler handler);
+        /**
+         * moves an address that accepted a connection to the front, so that the addresses tried before it are skipped next time
+         */
+        void prefer(const endpoint_type& endpoint);
+        /**
+         * moves an address that refused a connection to the back
+         */
+        void failed(const endpoint_type& endpoint);
+        /**
+         * serves a fixed address instead of resolving the host, e.g. the path of a unix domain socket
+         */
+        dns_cache& pin(const endpoint_type& endpoint);
+        /**
+         * resolves the host now, regardless of the ttl, unless another thread resolved it while this one waited
+         */
+        void refresh();
+        /**
+         * forces the next call to endpoints() to resolve the host
+         */
+        void invalidate();
+        /**
+         * number of times the host has been resolved
+         */
+        std::size_t resolutions() const;
+      private:
+        /**
+         * resolves the host and replaces the cached addresses, the caller holds _resolving
+         */
+        void resolve();
+        /**
+         * replaces the cached addresses with the resolved ones, keeping the preferred address in front
+         */
+        void store(const boost::asio::ip::tcp::resolver::results_type& results);
+        /**
+         * starts an asynchronous resolution, the caller holds _mutex
+         */
+        void start_refresh();
+    };
+    
+}
+
+#endif // ARANGOPP_DNS_H
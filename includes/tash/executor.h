@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_EXECUTOR_H
+#define ARANGOPP_EXECUTOR_H
+
+#include <memory>
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+namespace tash{
+    
+    /**
+     * an io_context run by a group of worker threads, completions of asynchronous operations are spread over the workers
+     * may be shared by many connections, which then have to outlive the operations they started
+     * without workers the io_context has to be run by the caller, as before
+     */
+    class executor: boost::noncopyable{
+        typedef boost::asio::executor_work_guard<boost::asio::io_context::executor_type> work_type;
+        
+        mutable boost::mutex        _mutex;
+        boost::asio::io_context     _io;
+        std::unique_ptr<work_type>  _work;
+        boost::thread_group         _workers;
+        std::size_t                 _size;
+      public:
+        /**
+         * starts the given number of worker threads, e.g. executor(std::thread::hardware_concurrency())
+         */
+        explicit executor(std::size_t threads = 0);
+        /**
+         * stops the workers, operations still in flight are abandoned
+         */
+        ~executor();
+        boost::asio::io_context& io(){return _io;}
+        /**
+         * number of worker threads running the io_context
+         */
+        std::size_t size() const;
+        /**
+         * adds worker threads, while there are workers the io_context does not run out of work, so the caller must not run() it
+         */
+        executor& start(std::size_t threads);
+        /**
+         * stops the io_context and joins the workers, the executor can be started again afterwards
+         */
+        void stop();
+    };
+    
+}
+
+#endif // ARANGOPP_EXECUTOR_H
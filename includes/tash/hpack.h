@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_HPACK_H
+#define ARANGOPP_HPACK_H
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace tash{
+    
+    /**
+     * HPACK, the header compression of HTTP/2
+     * https://tools.ietf.org/html/rfc7541
+     */
+    namespace hpack{
+        
+        /**
+         * a header field, the name in lower case
+         */
+        typedef std::pair<std::string, std::string> field_type;
+        typedef std::vector<field_type> fields_type;
+        
+        /**
+         * the dynamic table an encoder shares with the decoder of its peer, the newest entry first
+         */
+        class table{
+            std::deque<field_type> _entries;
+            std::size_t _size;
+            std::size_t _capacity;
+          public:
+            explicit table(std::size_t capacity = 4096);
+            /**
+             * limit of size(), evicts the oldest entries that do not fit any more
+             */
+            std::size_t capacity() const{return _capacity;}
+            void capacity(std::size_t capacity);
+            /**
+             * sum of the entry sizes, each counts its name, its value and 32 bytes
+             */
+            std::size_t size() const{return _size;}
+            void insert(const field_type& field);
+            /**
+             * the static entries come first (1 to 61), then the dynamic ones, throws std::invalid_argument for an index out of range
+             */
+            const field_type& at(std::size_t index) const;
+            /**
+             * index of the entry with the same name and value, or else of the first one with the same name, 0 if there is none
+             */
+            std::size_t find(const field_type& field, bool& exact) const;
+        };
+        
+        /**
+         * turns header lists into header blocks, fields that repeat from request to request (the authorization among them) shrink to a byte or two
+         */
+        class encoder{
+            table _table;
+            std::size_t _limit;
+            bool _resized;
+          public:
+            explicit encoder(std::size_t capacity = 4096);
+            /**
+             * the table size the peer allows (SETTINGS_HEADER_TABLE_SIZE), the table shrinks to it but does not grow past its initial capacity
+             */
+            void limit(std::size_t size);
+            /**
+             * appends the header block of the fields to out, values that differ for every request (the path, the content length) are not indexed
+             */
+            void encode(const fields_type& fields, std::string& out);
+        };
+        
+        /**
+         * turns header blocks back into header lists, the blocks have to be decoded in the order they arrived
+         */
+        class decoder{
+            table _table;
+            std::size_t _limit;
+          public:
+            explicit decoder(std::size_t capacity = 4096);
+            /**
+             * throws std::invalid_argument for malformed blocks, after which the connection cannot be used any more
+             */
+            fields_type decode(const std::uint8_t* data, std::size_t size);
+        };
+        
+        /**
+         * Huffman code of RFC 7541 Appendix B, decode throws std::invalid_argument for malformed input
+         */
+        std::size_t huffman_size(const std::string& text);
+        void huffman_encode(const std::string& text, std::string& out);
+        std::string huffman_decode(const std::uint8_t* data, std::size_t size);
+        
+    }
+    
+}
+
+#endif // ARANGOPP_HPACK_H
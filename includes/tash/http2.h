@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_HTTP2_H
+#define ARANGOPP_HTTP2_H
+
+#include <map>
+#include <deque>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <boost/asio.hpp>
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include "tash/dns.h"
+#include "tash/hpack.h"
+#include "tash/deadline.h"
+#include "tash/multiplexer.h"
+
+namespace tash{
+    
+    /**
+     * HTTP/2 connection to one server, requests of any number of threads are multiplexed as streams over a single socket
+     * the connection starts with prior knowledge (h2c, no upgrade), the headers are compressed with HPACK and the request bodies obey the flow control of the server
+     * https://tools.ietf.org/html/rfc7540
+     */
+    class http2: public multiplexer{
+        /**
+         * a request from the moment it is started until its response is complete
+         */
+        struct incoming{
+            handler_type    _handler;
+            request_type    _request;
+            std::uint32_t   _stream;
+            std::size_t     _offset;
+            std::int64_t    _window;
+            std::size_t     _received;
+            response_type   _response;
+            /**
+             * bounds opening the socket for the request, which is done on the thread of the socket
+             */
+            boost::optional<tash::deadline> _deadline;
+        };
+        
+        boost::mutex                    _mutex;
+        boost::asio::io_context         _io;
+        boost::asio::executor_work_guard<boost::asio::io_context::executor_type> _work;
+        boost::asio::generic::stream_protocol::socket _socket;
+        boost::thread                   _thread;
+        tash::dns_cache&                _dns;
+        bool                            _connected;
+        std::size_t                     _generation;
+        std::uint64_t                   _next;
+        std::atomic<std::size_t>        _count;
+        // the members below belong to the thread of the socket
+        bool                            _alive;
+        std::size_t                     _current;
+        std::map<std::uint64_t, incoming> _pending;
+        std::map<std::uint32_t, std::uint64_t> _streams;
+        std::deque<std::uint64_t>       _queued;
+        std::uint32_t                   _next_stream;
+        bool                            _draining;
+        tash::hpack::encoder            _encoder;
+        tash::hpack::decoder            _decoder;
+        std::uint32_t                   _max_streams;
+        std::uint32_t                   _max_frame;
+        std::int64_t                    _initial_window;
+        std::int64_t                    _window;
+        std::size_t                     _received;
+        std::string                     _output;
+        std::string                     _written;
+        bool                            _writing;
+        boost::beast::flat_buffer       _input;
+        std::uint32_t                   _continued;
+        bool                            _ended;
+        std::string                     _block;
+      public:
+        explicit http2(tash::dns_cache& dns);
+        ~http2() override;
+        /**
+         * opens the socket and exchanges the connection preface unless that has been done
+         * throws boost::system::system_error if the server cannot be reached or does not speak HTTP/2
+         */
+        void connect(const tash::deadline& deadline) override;
+        std::size_t pending() override;
+        response_type send(const request_type& request, const tash::deadline& deadline) override;
+        std::uint64_t start(const request_type& request, const tash::deadline& deadline, handler_type handler) override;
+        /**
+         * forgets a started request and resets its stream, its handler is not called
+         */
+        void abandon(std::uint64_t id) override;
+      private:
+        void established(std::size_t generation, const std::string& settings);
+        bool live(std::size_t generation) const{return _alive && generation == _current;}
+        void begin(std::uint64_t id);
+        void open(std::uint64_t id, incoming& request);
+        void pump(incoming& request);
+        void drain();
+        void complete(std::uint64_t id, const boost::system::error_code& ec, bool delivered);
+        void frame(std::uint8_t type, std::uint8_t flags, std::uint32_t stream, const char* payload, std::size_t size);
+        void flush();
+        void read(std::size_t generation);
+        void received(std::uint8_t type, std::uint8_t flags, std::uint32_t stream, const std::uint8_t* payload, std::size_t size);
+        void headers();
+        void settings(const std::uint8_t* payload, std::size_t size);
+        void goaway(std::uint32_t last);
+        void fail(std::size_t generation, const boost::system::error_code& ec);
+        void retire();
+    };
+    
+}
+
+#endif // ARANGOPP_HTTP2_H
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_LIMITER_H
+#define ARANGOPP_LIMITER_H
+
+#include <chrono>
+#include <cstddef>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace tash{
+    
+    /**
+     * adaptive cap on the requests in flight to one coordinator (additive increase, multiplicative decrease)
+     * the limit grows by about one for every limit successful requests and shrinks by the backoff factor whenever a request fails
+     * or takes more than tolerance times the latency of the fastest recent requests, requests beyond the limit are rejected
+     */
+    class limiter: boost::noncopyable{
+      public:
+        typedef std::chrono::steady_clock clock_type;
+        
+        struct settings{
+            bool        enabled;
+            std::size_t initial;
+            std::size_t minimum;
+            std::size_t maximum;
+            double      backoff;
+            double      tolerance;
+            
+            explicit settings(bool enabled = false, std::size_t initial = 20, std::size_t minimum = 1, std::size_t maximum = 1000, double backoff = 0.9, double tolerance = 2.0);
+        };
+        struct statistics{
+            std::size_t               limit;
+            std::size_t               inflight;
+            std::size_t               admitted;
+            std::size_t               rejected;
+            std::chrono::microseconds baseline;
+        };
+      private:
+        mutable boost::mutex _mutex;
+        settings             _settings;
+        double               _limit;
+        std::size_t          _inflight;
+        double               _baseline;
+        std::size_t          _admitted;
+        std::size_t          _rejected;
+      public:
+        limiter();
+        settings configuration() const;
+        /**
+         * applies the settings and starts over from the initial limit, disabled by default
+         */
+        limiter& configure(const settings& s);
+        /**
+         * admits a request unless the limit is reached
+         */
+        bool acquire();
+        /**
+         * completes an admitted request and adapts the limit to its outcome
+         */
+        void release(clock_type::duration elapsed, bool success);
+        /**
+         * completes an admitted request without an outcome, e.g. one cancelled by the caller
+         */
+        void release();
+        std::size_t limit() const;
+        statistics stats() const;
+    };
+    
+    /**
+     * stops sending requests to a coordinator once the failure rate within a window crosses the threshold
+     * after the cooldown a few probe requests are let through, the circuit closes again if they succeed and reopens otherwise
+     */
+    class breaker: boost::noncopyable{
+      public:
+        typedef std::chrono::steady_clock clock_type;
+        
+        enum class state{
+            closed,
+            open,
+            half_open
+        };
+        struct settings{
+            bool                      enabled;
+            double                    threshold;
+            std::size_t               minimum;
+            std::chrono::milliseconds window;
+            std::chrono::milliseconds cooldown;
+            std::size_t               probes;
+            
+            explicit settings(bool enabled = false, double threshold = 0.5, std::size_t minimum = 20, std::chrono::milliseconds window = std::chrono::milliseconds(10000), std::chrono::milliseconds cooldown = std::chrono::milliseconds(5000), std::size_t probes = 1);
+        };
+        struct statistics{
+            state       current;
+            std::size_t requests;
+            std::size_t failures;
+            std::size_t opened;
+            std::size_t rejected;
+        };
+      private:
+        mutable boost::mutex   _mutex;
+        settings               _settings;
+        state                  _state;
+        clock_type::time_point _window;
+        clock_type::time_point _opened_at;
+        std::size_t            _requests;
+        std::size_t            _failures;
+        std::size_t            _probing;
+        std::size_t            _opened;
+        std::size_t            _rejected;
+        
+        state current(clock_type::time_point now) const;
+      public:
+        breaker();
+        settings configuration() const;
+        /**
+         * applies the settings and closes the circuit, disabled by default
+         */
+        breaker& configure(const settings& s);
+        /**
+         * whether a request may be sent, an open circuit turns half open once the cooldown has passed
+         */
+        bool allow();
+        /**
+         * the outcome of an allowed request
+         */
+        void record(bool success);
+        /**
+         * an allowed request without an outcome, e.g. one cancelled by the caller
+         */
+        void discard();
+        state current() const;
+        statistics stats() const;
+    };
+    
+}
+
+#endif // ARANGOPP_LIMITER_H
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_MULTIPLEXER_H
+#define ARANGOPP_MULTIPLEXER_H
+
+#include <cstdint>
+#include <functional>
+#include <boost/noncopyable.hpp>
+#include <boost/beast/http.hpp>
+#include "tash/deadline.h"
+
+namespace tash{
+    
+    /**
+     * a single socket to one server that carries the requests of any number of threads at once, e.g. VelocyStream or HTTP/2
+     * the socket is served by a thread of its own, callers wait on the response or get a callback from that thread
+     */
+    class multiplexer: boost::noncopyable{
+      public:
+        typedef boost::beast::http::request<boost::beast::http::string_body>    request_type;
+        typedef boost::beast::http::response<boost::beast::http::dynamic_body>  response_type;
+        /**
+         * completion of a request, delivered is false if the request never reached the server (so it may be sent elsewhere)
+         */
+        typedef std::function<void(boost::system::error_code, response_type, bool delivered)> handler_type;
+        
+        virtual ~multiplexer(){}
+        /**
+         * opens the socket unless that has been done, bounded by the connect timeout and the total deadline
+         * throws boost::system::system_error if the server cannot be reached
+         */
+        virtual void connect(const tash::deadline& deadline) = 0;
+        /**
+         * number of requests that wait for their response
+         */
+        virtual std::size_t pending() = 0;
+        /**
+         * sends the request and blocks until its response arrives, other threads may send their requests in the meantime
+         * gives up with boost::asio::error::timed_out or operation_aborted once the deadline passes or the request is cancelled
+         */
+        virtual response_type send(const request_type& request, const tash::deadline& deadline) = 0;
+        /**
+         * sends the request and returns its id, the handler is called on the thread of the socket
+         * if the socket has to be opened for the request, the connect timeout and the total deadline of the request bound that
+         */
+        virtual std::uint64_t start(const request_type& request, const tash::deadline& deadline, handler_type handler) = 0;
+        /**
+         * forgets a started request, its handler is not called and a late response is dropped
+         */
+        virtual void abandon(std::uint64_t id) = 0;
+    };
+    
+}
+
+#endif // ARANGOPP_MULTIPLEXER_H
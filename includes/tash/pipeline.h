@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_PIPELINE_H
+#define ARANGOPP_PIPELINE_H
+
+#include <vector>
+#include "tash/connection.h"
+
+namespace tash{
+    
+    /**
+     * HTTP/1.1 pipelining of independent requests
+     * the requests are written back to back on one keep-alive socket and the responses are read in the same order,
+     * so a burst of N requests costs roughly one round trip instead of N
+     * no more than window() requests and 64 KiB of them are written ahead of their responses, so neither end blocks on a full socket buffer
+     * 
+     * tash::pipeline pipe(school);
+     * pipe.add("_api/document/students/1").add("_api/document/students/2");
+     * std::vector<tash::http_response_type> responses = pipe.execute();
+     * 
+     * pipelined requests may be processed before any response is seen, so only requests that do not depend on each other should be added
+     */
+    class pipeline: boost::noncopyable{
+        connection&                    _conn;
+        std::vector<http_request_type> _requests;
+        std::size_t                    _window;
+      public:
+        explicit pipeline(connection& conn);
+        pipeline& add(const http_request_type& request);
+        pipeline& add(std::string path, boost::beast::http::verb method = boost::beast::http::verb::get);
+        pipeline& add(std::string path, const std::string& content, std::string type = "application/json", boost::beast::http::verb method = boost::beast::http::verb::post);
+        std::size_t size() const{return _requests.size();}
+        bool empty() const{return _requests.empty();}
+        void clear();
+        /**
+         * the number of requests written ahead of their responses, 32 by default
+         */
+        std::size_t window() const{return _window;}
+        /**
+         * throws std::invalid_argument for a window of 0
+         */
+        pipeline& window(std::size_t requests);
+        /**
+         * sends all requests and returns their responses in the order the requests were added
+         * requests left unanswered because the server closed the socket are transparently sent again on a fresh socket
+         */
+        std::vector<http_response_type> execute();
+        /**
+         * execute() bounded by the given timeouts and cancellable through the token of the options, the deadline covers the whole burst
+         */
+        std::vector<http_response_type> execute(const tash::request_options& options);
+    };
+    
+}
+
+#endif // ARANGOPP_PIPELINE_H
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_POOL_H
+#define ARANGOPP_POOL_H
+
+#include <deque>
+#include <chrono>
+#include <memory>
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include "tash/deadline.h"
+#include "tash/tls.h"
+
+namespace tash{
+    
+    /**
+     * A keep-alive socket together with the bookkeeping required to pool it
+     */
+    class channel: boost::noncopyable{
+      public:
+        typedef std::chrono::steady_clock clock_type;
+        /**
+         * a TCP or a unix domain socket
+         */
+        typedef boost::asio::generic::stream_protocol::socket socket_type;
+      private:
+        socket_type                     _socket;
+        boost::shared_ptr<tash::tls>    _secure;
+        std::unique_ptr<tash::tls_stream> _tls;
+        clock_type::time_point          _last_used;
+        std::size_t                     _requests;
+      public:
+        explicit channel(boost::asio::io_context& io);
+        ~channel();
+        socket_type& socket(){return _socket;}
+        /**
+         * the TLS layer of a connected channel of an ssl:// node, null for plain channels and before secure() is called
+         */
+        tash::tls_stream* tls(){return _tls.get();}
+        /**
+         * puts a TLS layer on the connected socket, the handshake is up to the caller
+         */
+        tash::tls_stream& secure(boost::shared_ptr<tash::tls> settings);
+        std::size_t requests() const{return _requests;}
+        clock_type::time_point last_used() const{return _last_used;}
+        bool is_open() const{return _socket.is_open();}
+        /**
+         * true if the peer has not closed or written unsolicited data on an idle socket
+         */
+        bool alive();
+        void touch();
+        void close();
+        /**
+         * true for the errors a reused keep-alive socket yields when the server has already closed its end
+         */
+        static bool stale(const boost::system::error_code& ec);
+        /**
+         * disables Nagle's algorithm on a connected TCP socket, unix domain sockets are left alone
+         */
+        static void no_delay(socket_type& socket);
+    };
+    
+    /**
+     * synchronous stream over a channel bounded by a deadline, through the TLS layer if the channel has one
+     */
+    class channel_stream: boost::noncopyable{
+        tash::deadline_stream   _plain;
+        tash::tls_stream*       _secure;
+      public:
+        channel_stream(channel& ch, const tash::deadline& deadline);
+        ~channel_stream();
+        
+        template <typename ConstBufferSequence>
+        std::size_t write_some(const ConstBufferSequence& buffers, boost::system::error_code& ec){
+            return _secure ? _secure->write_some(buffers, ec) : _plain.write_some(buffers, ec);
+        }
+        template <typename ConstBufferSequence>
+        std::size_t write_some(const ConstBufferSequence& buffers){
+            return _secure ? _secure->write_some(buffers) : _plain.write_some(buffers);
+        }
+        template <typename MutableBufferSequence>
+        std::size_t read_some(const MutableBufferSequence& buffers, boost::system::error_code& ec){
+            return _secure ? _secure->read_some(buffers, ec) : _plain.read_some(buffers, ec);
+        }
+        template <typename MutableBufferSequence>
+        std::size_t read_some(const MutableBufferSequence& buffers){
+            return _secure ? _secure->read_some(buffers) : _plain.read_some(buffers);
+        }
+        /**
+         * the TLS handshake of a freshly secured channel, counted in the statistics of settings
+         */
+        void handshake(tash::tls& settings, boost::system::error_code& ec);
+    };
+    
+    /**
+     * pool of idle keep-alive channels of a connection
+     * channels are handed out most recently used first and are evicted after staying idle for longer than max_idle()
+     */
+    class pool: boost::noncopyable{
+      public:
+        typedef std::unique_ptr<channel> channel_ptr;
+        typedef channel::clock_type clock_type;
+        
+        struct statistics{
+            std::size_t hits;
+            std::size_t misses;
+            std::size_t evictions;
+            std::size_t reconnects;
+            std::size_t idle;
+        };
+      private:
+        mutable boost::mutex        _mutex;
+        boost::asio::io_context&    _io;
+        std::deque<channel_ptr>     _idle;
+        std::size_t                 _capacity;
+        clock_type::duration        _max_idle;
+        statistics                  _stats;
+      public:
+        explicit pool(boost::asio::io_context& io, std::size_t capacity = 8, clock_type::duration max_idle = std::chrono::seconds(30));
+        std::size_t capacity() const;
+        pool& capacity(std::size_t size);
+        clock_type::duration max_idle() const;
+        pool& max_idle(clock_type::duration duration);
+        /**
+         * returns an idle connected channel if there is one (hit) or a new unconnected channel otherwise (miss)
+         */
+        channel_ptr acquire();
+        /**
+         * returns the channel to the pool unless it is closed or the pool is already full
+         */
+        void release(channel_ptr ch);
+        /**
+         * records that a pooled channel turned out to be stale and had to be reconnected
+         */
+        void reconnected();
+        void clear();
+        statistics stats() const;
+      private:
+        void evict(clock_type::time_point now);
+    };
+    
+}
+
+#endif // ARANGOPP_POOL_H
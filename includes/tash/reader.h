@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_READER_H
+#define ARANGOPP_READER_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <streambuf>
+#include <stdexcept>
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <nlohmann/json.hpp>
+#include "vpack.h"
+
+namespace tash{
+namespace detail{
+    
+    /**
+     * reads the buffers of a response body in place instead of joining them into one string first
+     */
+    class body_streambuf: public std::streambuf{
+        typedef boost::beast::http::dynamic_body::value_type::const_buffers_type buffers_type;
+        typedef decltype(boost::asio::buffer_sequence_begin(std::declval<const buffers_type&>())) iterator_type;
+        
+        buffers_type  _buffers;
+        iterator_type _next;
+        iterator_type _end;
+      public:
+        explicit body_streambuf(const buffers_type& buffers): _buffers(buffers), _next(boost::asio::buffer_sequence_begin(_buffers)), _end(boost::asio::buffer_sequence_end(_buffers)){}
+      protected:
+        int_type underflow() override{
+            while(_next != _end){
+                boost::asio::const_buffer buffer = *_next++;
+                if(buffer.size() > 0){
+                    char* begin = const_cast<char*>(static_cast<const char*>(buffer.data()));
+                    setg(begin, begin, begin + buffer.size());
+                    return traits_type::to_int_type(*begin);
+                }
+            }
+            return traits_type::eof();
+        }
+    };
+    
+    /**
+     * builds a nlohmann::json from SAX events, starting with the outermost object or array
+     */
+    class json_builder{
+        std::vector<nlohmann::json*> _stack;
+        std::vector<std::string>     _keys;
+      public:
+        bool building() const{return !_stack.empty();}
+        /**
+         * starts building the outermost container into root
+         */
+        void open(nlohmann::json& root, nlohmann::json::value_t type){
+            root = nlohmann::json(type);
+            _stack.push_back(&root);
+            _keys.emplace_back();
+        }
+        void start(nlohmann::json::value_t type){
+            _stack.push_back(add(nlohmann::json(type)));
+            _keys.emplace_back();
+        }
+        void value(nlohmann::json&& v){
+            add(std::move(v));
+        }
+        void key(nlohmann::json::string_t& k){
+            _keys.back() = std::move(k);
+        }
+        /**
+         * true once the outermost container is complete
+         */
+        bool end(){
+            _stack.pop_back();
+            _keys.pop_back();
+            return _stack.empty();
+        }
+      private:
+        nlohmann::json* add(nlohmann::json&& v){
+            nlohmann::json& parent = *_stack.back();
+            if(parent.is_array()){
+                parent.push_back(std::move(v));
+                return &parent.back();
+            }
+            nlohmann::json& slot = parent[_keys.back()];
+            slot = std::move(v);
+            return &slot;
+        }
+    };
+    
+    /**
+     * SAX handler for the body of a cursor response, the top level attributes but "result" are collected into meta() and the events within "result" go to the element policy
+     * the policy has value(), key(), start(type) which returns false to skip the value, and end() which returns false if it closes "result" itself
+     */
+    template <typename ElementT>
+    class cursor_sax{
+        ElementT&       _element;
+        nlohmann::json  _meta;
+        std::string     _key;
+        std::size_t     _depth;
+        std::size_t     _skip;
+        bool            _result;
+      public:
+        typedef nlohmann::json::number_integer_t  number_integer_t;
+        typedef nlohmann::json::number_unsigned_t number_unsigned_t;
+        typedef nlohmann::json::number_float_t    number_float_t;
+        typedef nlohmann::json::string_t          string_t;
+#if defined(TASH_JSON_HAS_BINARY)
+        typedef nlohmann::json::binary_t          binary_t;
+#endif
+        
+        explicit cursor_sax(ElementT& element): _element(element), _meta(nlohmann::json::object()), _depth(0), _skip(0), _result(false){}
+        nlohmann::json& meta(){return _meta;}
+        
+        bool null(){return value(nullptr);}
+        bool boolean(bool v){return value(v);}
+        bool number_integer(number_integer_t v){return value(v);}
+        bool number_unsigned(number_unsigned_t v){return value(v);}
+        bool number_float(number_float_t v, const string_t&){return value(v);}
+        bool string(string_t& v){return value(v);}
+#if defined(TASH_JSON_HAS_BINARY)
+        bool binary(binary_t& v){return value(v);}
+#endif
+        bool start_object(std::size_t){return start(nlohmann::json::value_t::object);}
+        bool start_array(std::size_t){return start(nlohmann::json::value_t::array);}
+        bool end_object(){return end();}
+        bool end_array(){return end();}
+        bool key(string_t& k){
+            if(_skip){
+                return true;
+            }
+            if(_result){
+                _element.key(k);
+            }else if(_depth == 1){
+                _key = std::move(k);
+            }
+            return true;
+        }
+        bool parse_error(std::size_t, const std::string&, const nlohmann::json::exception& error){
+            throw std::invalid_argument(error.what());
+        }
+      private:
+        template <typename V>
+        bool value(V&& v){
+            if(_skip){
+                return true;
+            }
+            if(_result){
+                _element.value(std::forward<V>(v));
+            }else if(_depth == 1){
+                _meta[_key] = nlohmann::json(std::move(v));
+            }
+            return true;
+        }
+        bool start(nlohmann::json::value_t type){
+            if(_skip){
+                ++_skip;
+            }else if(_result){
+                if(!_element.start(type)){
+                    _skip = 1;
+                }
+            }else if(_depth == 0){
+                _depth = 1;
+            }else if(_depth == 1 && _key == "result" && type == nlohmann::json::value_t::array){
+                _result = true;
+            }else{
+                // nested attributes like "extra" are not needed
+                _skip = 1;
+            }
+            return true;
+        }
+        bool end(){
+            if(_skip){
+                --_skip;
+            }else if(_result){
+                _result = _element.end();
+            }else{
+                _depth = 0;
+            }
+            return true;
+        }
+    };
+    
+    /**
+     * feeds an already decoded document to a SAX handler, the strings are moved out of it
+     */
+    template <typename SaxT>
+    void replay(nlohmann::json& value, SaxT& sax){
+        switch(value.type()){
+            case nlohmann::json::value_t::boolean:
+                sax.boolean(value.get<bool>());
+                break;
+            case nlohmann::json::value_t::number_integer:
+                sax.number_integer(value.get<nlohmann::json::number_integer_t>());
+                break;
+            case nlohmann::json::value_t::number_unsigned:
+                sax.number_unsigned(value.get<nlohmann::json::number_unsigned_t>());
+                break;
+            case nlohmann::json::value_t::number_float:
+                sax.number_float(value.get<nlohmann::json::number_float_t>(), nlohmann::json::string_t());
+                break;
+            case nlohmann::json::value_t::string:
+                sax.string(value.get_ref<nlohmann::json::string_t&>());
+                break;
+#if defined(TASH_JSON_HAS_BINARY)
+            case nlohmann::json::value_t::binary:
+                sax.binary(value.get_binary());
+                break;
+#endif
+            case nlohmann::json::value_t::object:
+                sax.start_object(value.size());
+                for(auto it = value.begin(); it != value.end(); ++it){
+                    nlohmann::json::string_t key = it.key();
+                    sax.key(key);
+                    replay(it.value(), sax);
+                }
+                sax.end_object();
+                break;
+            case nlohmann::json::value_t::array:
+                sax.start_array(value.size());
+                for(nlohmann::json& element: value){
+                    replay(element, sax);
+                }
+                sax.end_array();
+                break;
+            default:
+                sax.null();
+        }
+    }
+    
+}
+}
+
+#endif // ARANGOPP_READER_H
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_RETRY_H
+#define ARANGOPP_RETRY_H
+
+#include <chrono>
+#include <cstddef>
+#include <boost/thread/mutex.hpp>
+#include <boost/beast/http.hpp>
+
+namespace tash{
+    
+    /**
+     * how often and after which pause a failed request is sent again, the default makes a single attempt
+     * requests are only sent again if that is safe, see tash::idempotent()
+     */
+    struct retry_policy{
+        /**
+         * attempts including the first one
+         */
+        std::size_t                 attempts;
+        /**
+         * pause before the first retry, each further retry waits multiplier times longer up to maximum
+         */
+        std::chrono::milliseconds   initial;
+        std::chrono::milliseconds   maximum;
+        double                      multiplier;
+        /**
+         * fraction of each pause that is randomized, so that clients failing together do not retry together
+         */
+        double                      jitter;
+        /**
+         * the retry budget holds up to budget retries and every successful request adds refill to it,
+         * so a cluster that keeps failing sees retries for at most a fraction refill of the requests
+         */
+        double                      budget;
+        double                      refill;
+        
+        explicit retry_policy(std::size_t attempts = 1, std::chrono::milliseconds initial = std::chrono::milliseconds(50), std::chrono::milliseconds maximum = std::chrono::milliseconds(2000), double multiplier = 2.0, double jitter = 0.5);
+        /**
+         * the randomized pause before the given retry, counting from 1
+         */
+        std::chrono::milliseconds backoff(std::size_t retry) const;
+    };
+    
+    /**
+     * token bucket of retries shared by the requests of a connection
+     */
+    class retry_budget{
+        mutable boost::mutex _mutex;
+        double               _tokens;
+        double               _capacity;
+        double               _refill;
+      public:
+        retry_budget(double capacity = 10.0, double refill = 0.1);
+        void configure(double capacity, double refill);
+        /**
+         * takes a token for a retry, false if the budget is exhausted
+         */
+        bool withdraw();
+        /**
+         * credits a successful request
+         */
+        void deposit();
+        double tokens() const;
+    };
+    
+    /**
+     * whether sending a request twice has the same effect as sending it once, true for GET, HEAD and OPTIONS
+     * other requests are retried only if nothing was sent yet or the caller marks them idempotent in tash::request_options
+     */
+    bool idempotent(boost::beast::http::verb method);
+    /**
+     * whether a failed request may succeed when sent again, i.e. any transport failure except cancellation
+     */
+    bool transient(const boost::system::error_code& ec);
+    /**
+     * whether a response asks to be retried: 503 Service Unavailable, which covers "cluster backend unavailable" (1478)
+     * as well as coordinators that are starting up or shutting down
+     */
+    bool transient(const boost::beast::http::response<boost::beast::http::dynamic_body>& response);
+    
+}
+
+#endif // ARANGOPP_RETRY_H
@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_TLS_H
+#define ARANGOPP_TLS_H
+
+#include <memory>
+#include <string>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include "tash/deadline.h"
+
+namespace tash{
+    
+    /**
+     * the stream under the TLS layer of a channel
+     * asynchronous operations go to the socket directly, synchronous ones to the deadline_stream bound for the current request, or to the socket if none is bound
+     */
+    class tls_layer{
+      public:
+        typedef boost::asio::generic::stream_protocol::socket socket_type;
+        typedef socket_type::lowest_layer_type lowest_layer_type;
+        typedef socket_type::executor_type executor_type;
+      private:
+        socket_type&            _socket;
+        tash::deadline_stream*  _bound;
+      public:
+        explicit tls_layer(socket_type& socket): _socket(socket), _bound(0){}
+        executor_type get_executor(){return _socket.get_executor();}
+        lowest_layer_type& lowest_layer(){return _socket.lowest_layer();}
+        const lowest_layer_type& lowest_layer() const{return _socket.lowest_layer();}
+        void bind(tash::deadline_stream* stream){_bound = stream;}
+        
+        template <typename ConstBufferSequence>
+        std::size_t write_some(const ConstBufferSequence& buffers, boost::system::error_code& ec){
+            return _bound ? _bound->write_some(buffers, ec) : _socket.write_some(buffers, ec);
+        }
+        template <typename ConstBufferSequence>
+        std::size_t write_some(const ConstBufferSequence& buffers){
+            return _bound ? _bound->write_some(buffers) : _socket.write_some(buffers);
+        }
+        template <typename MutableBufferSequence>
+        std::size_t read_some(const MutableBufferSequence& buffers, boost::system::error_code& ec){
+            return _bound ? _bound->read_some(buffers, ec) : _socket.read_some(buffers, ec);
+        }
+        template <typename MutableBufferSequence>
+        std::size_t read_some(const MutableBufferSequence& buffers){
+            return _bound ? _bound->read_some(buffers) : _socket.read_some(buffers);
+        }
+        template <typename ConstBufferSequence, typename WriteHandler>
+        BOOST_ASIO_INITFN_RESULT_TYPE(WriteHandler, void(boost::system::error_code, std::size_t)) async_write_some(const ConstBufferSequence& buffers, WriteHandler&& handler){
+            return _socket.async_write_some(buffers, std::forward<WriteHandler>(handler));
+        }
+        template <typename MutableBufferSequence, typename ReadHandler>
+        BOOST_ASIO_INITFN_RESULT_TYPE(ReadHandler, void(boost::system::error_code, std::size_t)) async_read_some(const MutableBufferSequence& buffers, ReadHandler&& handler){
+            return _socket.async_read_some(buffers, std::forward<ReadHandler>(handler));
+        }
+    };
+    
+    typedef boost::asio::ssl::stream<tls_layer> tls_stream;
+    
+    /**
+     * TLS settings and the last session of a coordinator
+     * the session the server handed out (a session ticket with TLS 1.3) is offered again on every new socket, so that a reconnect resumes it instead of doing a full handshake
+     */
+    class tls: boost::noncopyable{
+      public:
+        struct statistics{
+            std::size_t handshakes;
+            std::size_t resumed;
+            std::size_t failures;
+        };
+      private:
+        mutable boost::mutex                            _mutex;
+        boost::shared_ptr<boost::asio::ssl::context>    _context;
+        std::string                                     _host;
+        SSL_SESSION*                                    _session;
+        statistics                                      _stats;
+      public:
+        tls(boost::shared_ptr<boost::asio::ssl::context> context, const std::string& host);
+        ~tls();
+        boost::asio::ssl::context& context(){return *_context;}
+        std::string host() const{return _host;}
+        /**
+         * a TLS stream over the connected socket that sends the server name and verifies the certificate against it, prepared to resume the last session
+         */
+        std::unique_ptr<tls_stream> wrap(tls_layer::socket_type& socket);
+        /**
+         * counts a completed or failed handshake of a stream returned by wrap()
+         */
+        void handshaked(tls_stream& stream, const boost::system::error_code& ec);
+        /**
+         * forgets the session, the next handshake is a full one
+         */
+        void forget();
+        /**
+         * handshakes: successful handshakes, resumed: those of them that resumed a session, failures: failed handshakes
+         */
+        statistics stats() const;
+        /**
+         * a client context with the system's certificate authorities and peer verification, used for ssl:// endpoints unless connection::tls() sets another one
+         */
+        static boost::shared_ptr<boost::asio::ssl::context> client();
+      private:
+        static int index();
+        static int on_session(SSL* ssl, SSL_SESSION* session);
+    };
+    
+}
+
+#endif // ARANGOPP_TLS_H
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_TYPED_H
+#define ARANGOPP_TYPED_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <istream>
+#include <stdexcept>
+#include <type_traits>
+#include <boost/lexical_cast.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <nlohmann/json.hpp>
+#include "connection.h"
+#include "reader.h"
+
+namespace tash{
+    
+    /**
+     * maps the attributes of a document to the members of T, specialized by the user in namespace tash, e.g.
+     * template <> struct mapping<student>{
+     *     static void map(tash::fields<student>& f){
+     *         f("name", &student::name)("age", &student::age);
+     *     }
+     * };
+     */
+    template <typename T>
+    struct mapping;
+    
+namespace detail{
+    
+    /**
+     * stores the values of an attribute in a member of type M, false if the value does not fit
+     * numbers are converted between the arithmetic types, nested objects and arrays need a nlohmann::json member
+     */
+    template <typename M>
+    struct slot{
+        static_assert(std::is_arithmetic<M>::value, "mapped members have to be bool, arithmetic, std::string or nlohmann::json");
+        static bool assign(M&, bool){return false;}
+        static bool assign(M& m, nlohmann::json::number_integer_t v){m = static_cast<M>(v); return true;}
+        static bool assign(M& m, nlohmann::json::number_unsigned_t v){m = static_cast<M>(v); return true;}
+        static bool assign(M& m, nlohmann::json::number_float_t v){m = static_cast<M>(v); return true;}
+        static bool assign(M&, nlohmann::json::string_t&){return false;}
+        static nlohmann::json* json(M&){return nullptr;}
+    };
+    template <>
+    struct slot<bool>{
+        static bool assign(bool& m, bool v){m = v; return true;}
+        static bool assign(bool&, nlohmann::json::number_integer_t){return false;}
+        static bool assign(bool&, nlohmann::json::number_unsigned_t){return false;}
+        static bool assign(bool&, nlohmann::json::number_float_t){return false;}
+        static bool assign(bool&, nlohmann::json::string_t&){return false;}
+        static nlohmann::json* json(bool&){return nullptr;}
+    };
+    template <>
+    struct slot<std::string>{
+        static bool assign(std::string&, bool){return false;}
+        static bool assign(std::string&, nlohmann::json::number_integer_t){return false;}
+        static bool assign(std::string&, nlohmann::json::number_unsigned_t){return false;}
+        static bool assign(std::string&, nlohmann::json::number_float_t){return false;}
+        // the string the parser allocated becomes the member, nothing is copied
+        static bool assign(std::string& m, nlohmann::json::string_t& v){m = std::move(v); return true;}
+        static nlohmann::json* json(std::string&){return nullptr;}
+    };
+    template <>
+    struct slot<nlohmann::json>{
+        template <typename V>
+        static bool assign(nlohmann::json& m, V&& v){m = std::move(v); return true;}
+        static nlohmann::json* json(nlohmann::json& m){return &m;}
+    };
+    
+    /**
+     * an attribute of T, a null value leaves the member as it is
+     */
+    template <typename T>
+    class member{
+        std::string _name;
+      public:
+        explicit member(std::string name): _name(std::move(name)){}
+        virtual ~member(){}
+        const std::string& name() const{return _name;}
+        void set(T&, std::nullptr_t) const{}
+        virtual void set(T& target, bool v) const = 0;
+        virtual void set(T& target, nlohmann::json::number_integer_t v) const = 0;
+        virtual void set(T& target, nlohmann::json::number_unsigned_t v) const = 0;
+        virtual void set(T& target, nlohmann::json::number_float_t v) const = 0;
+        virtual void set(T& target, nlohmann::json::string_t& v) const = 0;
+        /**
+         * the member nested objects and arrays are built into, null unless it is a nlohmann::json
+         */
+        virtual nlohmann::json* json(T& target) const = 0;
+      protected:
+        void mismatch() const{
+            throw std::invalid_argument("attribute "+_name+" does not fit the type of its member");
+        }
+    };
+    
+    template <typename T, typename M>
+    class member_of: public member<T>{
+        M T::* _pointer;
+      public:
+        member_of(std::string name, M T::* pointer): member<T>(std::move(name)), _pointer(pointer){}
+        void set(T& target, bool v) const override{store(target, v);}
+        void set(T& target, nlohmann::json::number_integer_t v) const override{store(target, v);}
+        void set(T& target, nlohmann::json::number_unsigned_t v) const override{store(target, v);}
+        void set(T& target, nlohmann::json::number_float_t v) const override{store(target, v);}
+        void set(T& target, nlohmann::json::string_t& v) const override{store(target, v);}
+        nlohmann::json* json(T& target) const override{return slot<M>::json(target.*_pointer);}
+      private:
+        template <typename V>
+        void store(T& target, V&& v) const{
+            if(!slot<M>::assign(target.*_pointer, std::forward<V>(v))){
+                this->mismatch();
+            }
+        }
+    };
+    
+}
+    
+    /**
+     * the mapped attributes of T, built once from mapping<T>::map()
+     */
+    template <typename T>
+    class fields{
+        std::vector<std::unique_ptr<detail::member<T>>> _members;
+      public:
+        fields() = default;
+        fields(const fields&) = delete;
+        fields& operator=(const fields&) = delete;
+        template <typename M>
+        fields& operator()(std::string name, M T::* pointer){
+            _members.emplace_back(new detail::member_of<T, M>(std::move(name), pointer));
+            return *this;
+        }
+        std::size_t size() const{return _members.size();}
+        /**
+         * the member of an attribute, null for attributes that are not mapped
+         * documents mostly list their attributes in the same order, so the search starts behind the previous match given by hint
+         */
+        const detail::member<T>* find(const std::string& name, std::size_t& hint) const{
+            for(std::size_t i = 0; i < _members.size(); ++i){
+                std::size_t index = (hint + i) % _members.size();
+                if(_members[index]->name() == name){
+                    hint = index + 1;
+                    return _members[index].get();
+                }
+            }
+            return nullptr;
+        }
+        static const fields& instance(){
+            static const fields<T> mapped = build();
+            return mapped;
+        }
+      private:
+        fields(fields&&) = default;
+        static fields build(){
+            fields<T> mapped;
+            mapping<T>::map(mapped);
+            return mapped;
+        }
+    };
+    
+namespace detail{
+    
+    /**
+     * element policy of cursor_sax that decodes each element of "result" into a T emplaced at the end of documents, attributes without a member are skipped
+     */
+    template <typename T>
+    class typed_element{
+        const tash::fields<T>&      _fields;
+        std::vector<T>&             _documents;
+        T*                          _document;
+        const detail::member<T>*    _member;
+        std::size_t                 _hint;
+        json_builder                _builder;
+      public:
+        explicit typed_element(std::vector<T>& documents): _fields(tash::fields<T>::instance()), _documents(documents), _document(nullptr), _member(nullptr), _hint(0){}
+        template <typename V>
+        void value(V&& v){
+            if(_builder.building()){
+                _builder.value(nlohmann::json(std::move(v)));
+            }else if(!_document){
+                throw std::invalid_argument("a typed cursor expects objects as results");
+            }else if(_member){
+                _member->set(*_document, std::forward<V>(v));
+            }
+        }
+#if defined(TASH_JSON_HAS_BINARY)
+        void value(nlohmann::json::binary_t& v){
+            if(_builder.building()){
+                _builder.value(nlohmann::json(std::move(v)));
+            }else if(!_document){
+                throw std::invalid_argument("a typed cursor expects objects as results");
+            }else if(_member){
+                nlohmann::json* target = _member->json(*_document);
+                if(!target){
+                    throw std::invalid_argument("attribute "+_member->name()+" is binary, its member has to be a nlohmann::json");
+                }
+                *target = nlohmann::json(std::move(v));
+            }
+        }
+#endif
+        void key(nlohmann::json::string_t& k){
+            if(_builder.building()){
+                _builder.key(k);
+            }else{
+                _member = _fields.find(k, _hint);
+            }
+        }
+        bool start(nlohmann::json::value_t type){
+            if(_builder.building()){
+                _builder.start(type);
+            }else if(_document){
+                if(!_member){
+                    return false;
+                }
+                nlohmann::json* target = _member->json(*_document);
+                if(!target){
+                    throw std::invalid_argument("attribute "+_member->name()+" is nested, its member has to be a nlohmann::json");
+                }
+                _builder.open(*target, type);
+            }else{
+                if(type != nlohmann::json::value_t::object){
+                    throw std::invalid_argument("a typed cursor expects objects as results");
+                }
+                _documents.emplace_back();
+                _document = &_documents.back();
+                _member   = nullptr;
+                _hint     = 0;
+            }
+            return true;
+        }
+        bool end(){
+            if(_builder.building()){
+                _builder.end();
+            }else if(_document){
+                _document = nullptr;
+                _member   = nullptr;
+            }else{
+                return false;
+            }
+            return true;
+        }
+    };
+    
+}
+    
+    /**
+     * a cursor that decodes its documents into T through mapping<T> while the response is parsed, e.g.
+     * tash::typed_cursor<student> students(school, "FOR s IN students RETURN s");
+     * for(const student& s: students){ ... }
+     * no nlohmann::json is built for a document except for members of that type, and the batches are fetched and replaced like those of a cursor
+     * throws std::invalid_argument if a result is not an object or an attribute does not fit its member
+     */
+    template <typename T>
+    class typed_cursor{
+        connection&     _conn;
+        cursor          _cursor;
+        std::vector<T>  _results;
+      public:
+        typedef T value_type;
+        
+        /**
+         * input iterator over the documents of all remaining batches, see cursor::iterator
+         */
+        typedef detail::batch_iterator<typed_cursor, T> iterator;
+        
+        typed_cursor(connection& conn, const std::string& q, int count = 0, int batch = 0);
+        template <typename AqlT>
+        typed_cursor(connection& conn, const AqlT& q, int count = 0, int batch = 0): typed_cursor(conn, boost::lexical_cast<std::string>(q), count, batch){}
+        iterator begin(){return iterator(this);}
+        iterator end(){return iterator();}
+        /**
+         * replaces the documents by those of the next batch
+         */
+        void fetch();
+        bool has_more() const{return _cursor.has_more();}
+        bool error() const{return _cursor.error();}
+        int count() const{return _cursor.count();}
+        int code() const {return _cursor.code();}
+        /**
+         * the documents of the current batch, they may be moved from
+         */
+        std::vector<T>& results(){return _results;}
+        const std::vector<T>& results() const{return _results;}
+        node_ptr coordinator() const{return _cursor.coordinator();}
+      private:
+        template <typename CursorT, typename ValueT>
+        friend class detail::batch_iterator;
+        std::size_t batch_size() const{return _results.size();}
+        T& element(std::size_t index){return _results[index];}
+        bool failed() const{return _cursor.error();}
+        void attach(const http_response_type& response);
+    };
+}
+
+template <typename T>
+tash::typed_cursor<T>::typed_cursor(tash::connection& conn, const std::string& q, int count, int batch): _conn(conn), _cursor(conn){
+    http_response_type response = _conn.query(_conn.aql_request(q, count, batch), _cursor._node);
+    attach(response);
+}
+
+template <typename T>
+void tash::typed_cursor<T>::fetch(){
+    http_response_type response = _conn.query(_cursor.next(), _cursor._node, _cursor.next_options());
+    attach(response);
+}
+
+template <typename T>
+void tash::typed_cursor<T>::attach(const tash::http_response_type& response){
+    std::vector<T> documents;
+    detail::typed_element<T> element(documents);
+    detail::cursor_sax<detail::typed_element<T>> reader(element);
+    if(boost::algorithm::istarts_with(response[boost::beast::http::field::content_type], "application/x-velocypack")){
+        // VelocyPack is decoded as a whole, the documents are mapped from the decoded body
+        nlohmann::json json = tash::connection::parse(response);
+        detail::replay(json, reader);
+    }else{
+        detail::body_streambuf buffer(response.body().data());
+        std::istream stream(&buffer);
+        nlohmann::json::sax_parse(stream, &reader);
+    }
+    reader.meta()["result"] = nlohmann::json::array();
+    _cursor.adopt(reader.meta());
+    _results = std::move(documents);
+}
+
+#endif // ARANGOPP_TYPED_H
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_VPACK_H
+#define ARANGOPP_VPACK_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <nlohmann/json.hpp>
+
+#if NLOHMANN_JSON_VERSION_MAJOR > 3 || (NLOHMANN_JSON_VERSION_MAJOR == 3 && NLOHMANN_JSON_VERSION_MINOR >= 8)
+/**
+ * nlohmann::json has a binary value type since 3.8, its SAX handlers and switches over value_t have to deal with it
+ */
+# define TASH_JSON_HAS_BINARY 1
+#endif
+
+namespace tash{
+    
+    /**
+     * VelocyPack, the binary format ArangoDB uses natively (application/x-velocypack)
+     * https://github.com/arangodb/velocypack/blob/main/VelocyPack.md
+     */
+    namespace vpack{
+        
+        /**
+         * encodes a document, arrays and objects are written with index tables and the attributes of objects are sorted
+         * binary values of nlohmann::json 3.8 and later are written as VelocyPack Binary
+         */
+        std::string encode(const nlohmann::json& document);
+        /**
+         * decodes the value that starts at data, all compound formats and the translated attribute names of ArangoDB (_key, _rev, _id, _from, _to) are understood
+         * UTC dates are decoded to their milliseconds and binary data to a string, throws std::invalid_argument for malformed input and for BCD, external or custom values
+         */
+        nlohmann::json decode(const std::uint8_t* data, std::size_t size);
+        nlohmann::json decode(const std::string& data);
+        /**
+         * size in bytes of the value that starts at data
+         */
+        std::size_t size(const std::uint8_t* data, std::size_t available);
+        
+    }
+    
+}
+
+#endif // ARANGOPP_VPACK_H
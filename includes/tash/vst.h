@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#ifndef ARANGOPP_VST_H
+#define ARANGOPP_VST_H
+
+#include <map>
+#include <deque>
+#include <string>
+#include <atomic>
+#include <cstdint>
+#include <boost/asio.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include "tash/dns.h"
+#include "tash/deadline.h"
+#include "tash/multiplexer.h"
+
+namespace tash{
+    
+    /**
+     * VelocyStream 1.1 connection to one server, requests of any number of threads are multiplexed over a single socket
+     * messages are split into chunks that carry the message id, so responses may arrive in any order
+     * https://github.com/arangodb/velocystream
+     */
+    class velocystream: public multiplexer{
+      private:
+        /**
+         * a message whose chunks are still arriving
+         */
+        struct incoming{
+            handler_type    _handler;
+            std::string     _data;
+            std::uint64_t   _length;
+        };
+        
+        boost::mutex                    _mutex;
+        boost::asio::io_context         _io;
+        boost::asio::executor_work_guard<boost::asio::io_context::executor_type> _work;
+        boost::asio::generic::stream_protocol::socket _socket;
+        boost::thread                   _thread;
+        tash::dns_cache&                _dns;
+        std::string                     _user;
+        std::string                     _pass;
+        std::size_t                     _chunk_size;
+        bool                            _connected;
+        std::size_t                     _generation;
+        std::uint64_t                   _next;
+        std::map<std::uint64_t, incoming> _pending;
+        std::deque<std::string>         _outgoing;
+        bool                            _writing;
+        char                            _header[24];
+        std::string                     _chunk;
+      public:
+        velocystream(tash::dns_cache& dns, const std::string& user, const std::string& pass);
+        ~velocystream() override;
+        /**
+         * maximum size of a chunk including its 24 byte header, 30000 by default
+         */
+        std::size_t chunk_size() const{return _chunk_size;}
+        velocystream& chunk_size(std::size_t size);
+        /**
+         * opens the socket and authenticates unless that has been done, throws boost::system::system_error if the server cannot be reached
+         */
+        void connect();
+        void connect(const tash::deadline& deadline) override;
+        std::size_t pending() override;
+        /**
+         * sends the request and blocks until its response arrives, other threads may send their requests in the meantime
+         */
+        response_type send(const request_type& request);
+        response_type send(const request_type& request, const tash::deadline& deadline) override;
+        std::uint64_t start(const request_type& request, const tash::deadline& deadline, handler_type handler) override;
+        void abandon(std::uint64_t id) override;
+      private:
+        std::string message(const request_type& request) const;
+        std::string chunks(std::uint64_t id, const std::string& message) const;
+        void enqueue(std::string data);
+        void write();
+        void read(std::size_t generation);
+        void received(std::size_t generation);
+        void fail(std::size_t generation, const boost::system::error_code& ec);
+    };
+    
+}
+
+#endif // ARANGOPP_VST_H
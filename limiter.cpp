@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/limiter.h"
+#include <algorithm>
+
+tash::limiter::settings::settings(bool enabled, std::size_t initial, std::size_t minimum, std::size_t maximum, double backoff, double tolerance)
+    : enabled(enabled), initial(initial), minimum(minimum), maximum(maximum), backoff(backoff), tolerance(tolerance){}
+
+tash::limiter::limiter(): _limit(static_cast<double>(_settings.initial)), _inflight(0), _baseline(0.0), _admitted(0), _rejected(0){}
+
+tash::limiter::settings tash::limiter::configuration() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _settings;
+}
+
+tash::limiter& tash::limiter::configure(const settings& s){
+    boost::mutex::scoped_lock lock(_mutex);
+    _settings = s;
+    _limit    = static_cast<double>(std::min(std::max(s.initial, s.minimum), s.maximum));
+    _baseline = 0.0;
+    return *this;
+}
+
+bool tash::limiter::acquire(){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(_settings.enabled && static_cast<double>(_inflight) >= _limit){
+        ++_rejected;
+        return false;
+    }
+    ++_inflight;
+    ++_admitted;
+    return true;
+}
+
+void tash::limiter::release(clock_type::duration elapsed, bool success){
+    boost::mutex::scoped_lock lock(_mutex);
+    const std::size_t inflight = _inflight;
+    if(_inflight > 0){
+        --_inflight;
+    }
+    if(!_settings.enabled){
+        return;
+    }
+    double sample = std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(elapsed).count();
+    bool overloaded = !success;
+    if(success){
+        // the baseline follows the fastest requests and drifts up slowly, so it adapts when the coordinator gets slower for good
+        _baseline  = (_baseline == 0.0 || sample < _baseline) ? sample : _baseline + 0.01 * (sample - _baseline);
+        overloaded = sample > _settings.tolerance * _baseline;
+    }
+    if(overloaded){
+        _limit = std::max(static_cast<double>(_settings.minimum), _limit * _settings.backoff);
+    }else if(2 * inflight >= static_cast<std::size_t>(_limit)){
+        // the limit only grows while it is actually used
+        _limit = std::min(static_cast<double>(_settings.maximum), _limit + 1.0 / _limit);
+    }
+}
+
+void tash::limiter::release(){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(_inflight > 0){
+        --_inflight;
+    }
+}
+
+std::size_t tash::limiter::limit() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return static_cast<std::size_t>(_limit);
+}
+
+tash::limiter::statistics tash::limiter::stats() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    statistics stats;
+    stats.limit    = static_cast<std::size_t>(_limit);
+    stats.inflight = _inflight;
+    stats.admitted = _admitted;
+    stats.rejected = _rejected;
+    stats.baseline = std::chrono::microseconds(static_cast<std::chrono::microseconds::rep>(_baseline));
+    return stats;
+}
+
+tash::breaker::settings::settings(bool enabled, double threshold, std::size_t minimum, std::chrono::milliseconds window, std::chrono::milliseconds cooldown, std::size_t probes)
+    : enabled(enabled), threshold(threshold), minimum(minimum), window(window), cooldown(cooldown), probes(probes){}
+
+tash::breaker::breaker(): _state(state::closed), _window(clock_type::now()), _requests(0), _failures(0), _probing(0), _opened(0), _rejected(0){}
+
+tash::breaker::settings tash::breaker::configuration() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _settings;
+}
+
+tash::breaker& tash::breaker::configure(const settings& s){
+    boost::mutex::scoped_lock lock(_mutex);
+    _settings = s;
+    _state    = state::closed;
+    _window   = clock_type::now();
+    _requests = 0;
+    _failures = 0;
+    _probing  = 0;
+    return *this;
+}
+
+tash::breaker::state tash::breaker::current(clock_type::time_point now) const{
+    if(_state == state::open && now >= _opened_at + _settings.cooldown){
+        return state::half_open;
+    }
+    return _state;
+}
+
+bool tash::breaker::allow(){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(!_settings.enabled){
+        return true;
+    }
+    state s = current(clock_type::now());
+    if(s == state::closed){
+        return true;
+    }
+    if(s == state::half_open && _probing < _settings.probes){
+        _state = state::half_open;
+        ++_probing;
+        return true;
+    }
+    ++_rejected;
+    return false;
+}
+
+void tash::breaker::record(bool success){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(!_settings.enabled){
+        return;
+    }
+    clock_type::time_point now = clock_type::now();
+    if(_state == state::half_open){
+        if(_probing > 0){
+            --_probing;
+        }
+        if(success){
+            _state    = state::closed;
+            _window   = now;
+            _requests = 0;
+            _failures = 0;
+        }else{
+            _state     = state::open;
+            _opened_at = now;
+            ++_opened;
+        }
+        return;
+    }
+    if(_state == state::open){
+        // a request admitted before the circuit opened
+        return;
+    }
+    if(now - _window > _settings.window){
+        _window   = now;
+        _requests = 0;
+        _failures = 0;
+    }
+    ++_requests;
+    if(!success){
+        ++_failures;
+    }
+    if(_requests >= _settings.minimum && static_cast<double>(_failures) >= _settings.threshold * static_cast<double>(_requests)){
+        _state     = state::open;
+        _opened_at = now;
+        ++_opened;
+    }
+}
+
+void tash::breaker::discard(){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(_state == state::half_open && _probing > 0){
+        --_probing;
+    }
+}
+
+tash::breaker::state tash::breaker::current() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    if(!_settings.enabled){
+        return state::closed;
+    }
+    return current(clock_type::now());
+}
+
+tash::breaker::statistics tash::breaker::stats() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    statistics stats;
+    stats.current  = _settings.enabled ? current(clock_type::now()) : state::closed;
+    stats.requests = _requests;
+    stats.failures = _failures;
+    stats.opened   = _opened;
+    stats.rejected = _rejected;
+    return stats;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/pipeline.h"
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+namespace{
+    /**
+     * bytes of unanswered requests on the socket beyond which no further request is written ahead
+     */
+    const std::size_t ahead_limit = 64 * 1024;
+    
+    /**
+     * the bytes a request occupies on the socket, the head is estimated
+     */
+    std::size_t weight(const tash::http_request_type& request){
+        return request.body().size() + request.target().size() + 512;
+    }
+}
+
+tash::pipeline::pipeline(tash::connection& conn): _conn(conn), _window(32){}
+
+tash::pipeline& tash::pipeline::window(std::size_t requests){
+    if(requests == 0){
+        throw std::invalid_argument("a pipeline needs a window of at least one request");
+    }
+    _window = requests;
+    return *this;
+}
+
+tash::pipeline& tash::pipeline::add(const tash::http_request_type& request){
+    _requests.push_back(request);
+    return *this;
+}
+
+tash::pipeline& tash::pipeline::add(std::string path, boost::beast::http::verb method){
+    return add(_conn.request(path, method));
+}
+
+tash::pipeline& tash::pipeline::add(std::string path, const std::string& content, std::string type, boost::beast::http::verb method){
+    return add(_conn.request(path, content, type, method));
+}
+
+void tash::pipeline::clear(){
+    _requests.clear();
+}
+
+std::vector<tash::http_response_type> tash::pipeline::execute(){
+    return execute(tash::request_options(_conn.timeouts()));
+}
+
+std::vector<tash::http_response_type> tash::pipeline::execute(const tash::request_options& options){
+    const tash::deadline deadline(options);
+    std::vector<tash::http_response_type> responses;
+    responses.reserve(_requests.size());
+    // the whole burst goes to one coordinator
+    tash::node_ptr target = _conn._balancer.pick();
+    if(boost::shared_ptr<tash::multiplexer> stream = target->stream()){
+        // VelocyStream and HTTP/2 multiplex by themselves, all requests are sent at once and collected in order
+        std::vector<std::future<tash::http_response_type>> futures;
+        std::vector<std::uint64_t> ids;
+        futures.reserve(_requests.size());
+        ids.reserve(_requests.size());
+        for(const tash::http_request_type& request: _requests){
+            std::shared_ptr<std::promise<tash::http_response_type>> promise = std::make_shared<std::promise<tash::http_response_type>>();
+            futures.push_back(promise->get_future());
+            ids.push_back(stream->start(request, deadline, [promise](boost::system::error_code ec, tash::http_response_type response, bool){
+                if(ec){
+                    promise->set_exception(std::make_exception_ptr(boost::system::system_error(ec)));
+                }else{
+                    promise->set_value(std::move(response));
+                }
+            }));
+        }
+        // a cancellable wait wakes up regularly to look at the token
+        const std::chrono::milliseconds slice(50);
+        for(std::size_t i = 0; i < futures.size(); ++i){
+            while(deadline.total() != tash::deadline::clock_type::time_point::max() || deadline.token()){
+                if(boost::system::error_code ec = deadline.check(deadline.total())){
+                    for(std::size_t j = i; j < ids.size(); ++j){
+                        stream->abandon(ids[j]);
+                    }
+                    throw boost::system::system_error(ec);
+                }
+                tash::deadline::clock_type::time_point until = std::min(deadline.total(), tash::deadline::clock_type::now() + slice);
+                if(futures[i].wait_until(until) == std::future_status::ready){
+                    break;
+                }
+            }
+            responses.push_back(futures[i].get());
+        }
+        return responses;
+    }
+    bool replayed = false;
+    while(responses.size() < _requests.size()){
+        bool reused = false;
+        tash::pool::channel_ptr ch = _conn.checkout(*target, reused, deadline);
+        std::size_t first = responses.size();
+        std::size_t written = first;
+        boost::system::error_code write_ec;
+        boost::beast::flat_buffer buffer;
+        boost::system::error_code read_ec;
+        bool closed = false;
+        {
+            // the socket is back to blocking mode before it is returned to the pool
+            tash::channel_stream stream(*ch, deadline);
+            // bytes of the requests written but not answered yet
+            std::size_t ahead = 0;
+            while(responses.size() < _requests.size() && !closed){
+                // the server stops reading while its responses are not read, so writes only run ahead within the window
+                while(!write_ec && written < _requests.size()){
+                    std::size_t outstanding = written - responses.size();
+                    if(outstanding > 0 && (outstanding >= _window || ahead + weight(_requests[written]) > ahead_limit)){
+                        break;
+                    }
+                    boost::beast::http::write(stream, _requests[written], write_ec);
+                    if(!write_ec){
+                        ahead += weight(_requests[written]);
+                        ++written;
+                    }
+                }
+                if(responses.size() == written){
+                    break;
+                }
+                tash::http_response_type res;
+                boost::beast::http::read(stream, buffer, res, read_ec);
+                if(read_ec){
+                    break;
+                }
+                ahead -= weight(_requests[responses.size()]);
+                ch->touch();
+                closed = !res.keep_alive();
+                tash::decode(res);
+                responses.push_back(std::move(res));
+            }
+        }
+        boost::system::error_code ec = read_ec ? read_ec : write_ec;
+        if(!ec && !closed){
+            target->pool().release(std::move(ch));
+            continue;
+        }
+        ch->close();
+        if(responses.size() > first && !read_ec){
+            // the server answered some of the requests and then closed the socket, the rest are sent again on a new one
+            continue;
+        }
+        if(responses.size() == first && reused && !replayed && tash::channel::stale(ec) && buffer.size() == 0){
+            replayed = true;
+            target->pool().reconnected();
+            continue;
+        }
+        throw boost::system::system_error(ec);
+    }
+    return responses;
+}
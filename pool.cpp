@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/pool.h"
+#include <boost/beast/http/error.hpp>
+#include <boost/asio/ssl/error.hpp>
+
+tash::channel::channel(boost::asio::io_context& io): _socket(io), _last_used(clock_type::now()), _requests(0){}
+
+bool tash::channel::alive(){
+    if(!_socket.is_open()){
+        return false;
+    }
+    boost::system::error_code ec;
+    char byte;
+    _socket.non_blocking(true, ec);
+    std::size_t bytes = _socket.receive(boost::asio::buffer(&byte, 1), boost::asio::socket_base::message_peek, ec);
+    boost::system::error_code restore;
+    _socket.non_blocking(false, restore);
+    // an idle keep-alive socket must have nothing to read, anything else means it has been closed or is out of sync
+    return ec == boost::asio::error::would_block && bytes == 0 && !restore;
+}
+
+tash::tls_stream& tash::channel::secure(boost::shared_ptr<tash::tls> settings){
+    _secure = settings;
+    _tls    = settings->wrap(_socket);
+    return *_tls;
+}
+
+void tash::channel::touch(){
+    _last_used = clock_type::now();
+    ++_requests;
+}
+
+tash::channel::~channel(){
+    close();
+}
+
+void tash::channel::close(){
+    boost::system::error_code ec;
+    if(_tls){
+        // without a close_notify OpenSSL would mark the session as not resumable when the stream is freed
+        SSL_set_shutdown(_tls->native_handle(), SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+    }
+    _socket.shutdown(socket_type::shutdown_both, ec);
+    _socket.close(ec);
+    _tls.reset();
+    _secure.reset();
+    _requests = 0;
+}
+
+bool tash::channel::stale(const boost::system::error_code& ec){
+    return ec == boost::beast::http::error::end_of_stream
+        || ec == boost::asio::error::eof
+        || ec == boost::asio::error::connection_reset
+        || ec == boost::asio::error::connection_aborted
+        || ec == boost::asio::error::broken_pipe
+        || ec == boost::asio::ssl::error::stream_truncated;
+}
+
+void tash::channel::no_delay(socket_type& socket){
+    boost::system::error_code ec;
+    socket_type::endpoint_type local = socket.local_endpoint(ec);
+    if(!ec && local.protocol().family() != AF_UNIX){
+        socket.set_option(boost::asio::ip::tcp::no_delay(true), ec);
+    }
+}
+
+tash::channel_stream::channel_stream(tash::channel& ch, const tash::deadline& deadline): _plain(ch.socket(), deadline), _secure(ch.tls()){
+    if(_secure){
+        _secure->next_layer().bind(&_plain);
+    }
+}
+
+tash::channel_stream::~channel_stream(){
+    if(_secure){
+        _secure->next_layer().bind(0);
+    }
+}
+
+void tash::channel_stream::handshake(tash::tls& settings, boost::system::error_code& ec){
+    _secure->handshake(boost::asio::ssl::stream_base::client, ec);
+    settings.handshaked(*_secure, ec);
+}
+
+tash::pool::pool(boost::asio::io_context& io, std::size_t capacity, clock_type::duration max_idle): _io(io), _capacity(capacity), _max_idle(max_idle), _stats{0, 0, 0, 0, 0}{}
+
+std::size_t tash::pool::capacity() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _capacity;
+}
+
+tash::pool& tash::pool::capacity(std::size_t size){
+    boost::mutex::scoped_lock lock(_mutex);
+    _capacity = size;
+    while(_idle.size() > _capacity){
+        _idle.front()->close();
+        _idle.pop_front();
+        ++_stats.evictions;
+    }
+    return *this;
+}
+
+tash::pool::clock_type::duration tash::pool::max_idle() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _max_idle;
+}
+
+tash::pool& tash::pool::max_idle(clock_type::duration duration){
+    boost::mutex::scoped_lock lock(_mutex);
+    _max_idle = duration;
+    return *this;
+}
+
+tash::pool::channel_ptr tash::pool::acquire(){
+    boost::mutex::scoped_lock lock(_mutex);
+    evict(clock_type::now());
+    while(!_idle.empty()){
+        channel_ptr ch = std::move(_idle.back());
+        _idle.pop_back();
+        if(ch->alive()){
+            ++_stats.hits;
+            return ch;
+        }
+        ch->close();
+        ++_stats.evictions;
+    }
+    ++_stats.misses;
+    return channel_ptr(new tash::channel(_io));
+}
+
+void tash::pool::release(channel_ptr ch){
+    if(!ch || !ch->is_open()){
+        return;
+    }
+    boost::mutex::scoped_lock lock(_mutex);
+    clock_type::time_point now = clock_type::now();
+    evict(now);
+    if(_idle.size() >= _capacity){
+        ch->close();
+        return;
+    }
+    _idle.push_back(std::move(ch));
+}
+
+void tash::pool::reconnected(){
+    boost::mutex::scoped_lock lock(_mutex);
+    ++_stats.reconnects;
+}
+
+void tash::pool::clear(){
+    boost::mutex::scoped_lock lock(_mutex);
+    for(channel_ptr& ch: _idle){
+        ch->close();
+    }
+    _idle.clear();
+}
+
+tash::pool::statistics tash::pool::stats() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    statistics stats = _stats;
+    stats.idle = _idle.size();
+    return stats;
+}
+
+void tash::pool::evict(clock_type::time_point now){
+    // _idle is ordered by last use, so expired channels are always at the front
+    while(!_idle.empty() && now - _idle.front()->last_used() > _max_idle){
+        _idle.front()->close();
+        _idle.pop_front();
+        ++_stats.evictions;
+    }
+}
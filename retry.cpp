@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/retry.h"
+#include <cmath>
+#include <random>
+#include <algorithm>
+#include <boost/asio/error.hpp>
+
+tash::retry_policy::retry_policy(std::size_t attempts, std::chrono::milliseconds initial, std::chrono::milliseconds maximum, double multiplier, double jitter)
+    : attempts(attempts), initial(initial), maximum(maximum), multiplier(multiplier), jitter(jitter), budget(10.0), refill(0.1){}
+
+std::chrono::milliseconds tash::retry_policy::backoff(std::size_t retry) const{
+    double pause = static_cast<double>(initial.count()) * std::pow(multiplier, static_cast<double>(retry > 0 ? retry-1 : 0));
+    pause = std::min(pause, static_cast<double>(maximum.count()));
+    static thread_local std::mt19937 generator(std::random_device{}());
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    pause *= 1.0 - std::min(std::max(jitter, 0.0), 1.0) * distribution(generator);
+    return std::chrono::milliseconds(static_cast<std::chrono::milliseconds::rep>(pause));
+}
+
+tash::retry_budget::retry_budget(double capacity, double refill): _tokens(capacity), _capacity(capacity), _refill(refill){}
+
+void tash::retry_budget::configure(double capacity, double refill){
+    boost::mutex::scoped_lock lock(_mutex);
+    _capacity = capacity;
+    _refill   = refill;
+    _tokens   = capacity;
+}
+
+bool tash::retry_budget::withdraw(){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(_tokens < 1.0){
+        return false;
+    }
+    _tokens -= 1.0;
+    return true;
+}
+
+void tash::retry_budget::deposit(){
+    boost::mutex::scoped_lock lock(_mutex);
+    _tokens = std::min(_capacity, _tokens + _refill);
+}
+
+double tash::retry_budget::tokens() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _tokens;
+}
+
+bool tash::idempotent(boost::beast::http::verb method){
+    return method == boost::beast::http::verb::get
+        || method == boost::beast::http::verb::head
+        || method == boost::beast::http::verb::options;
+}
+
+bool tash::transient(const boost::system::error_code& ec){
+    return ec && ec != boost::asio::error::operation_aborted;
+}
+
+bool tash::transient(const boost::beast::http::response<boost::beast::http::dynamic_body>& response){
+    return response.result() == boost::beast::http::status::service_unavailable;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/tls.h"
+#include <boost/make_shared.hpp>
+
+tash::tls::tls(boost::shared_ptr<boost::asio::ssl::context> context, const std::string& host): _context(context), _host(host), _session(0), _stats{0, 0, 0}{
+    // sessions are kept per coordinator by on_session(), not in the cache of the context
+    SSL_CTX_set_session_cache_mode(_context->native_handle(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(_context->native_handle(), &tash::tls::on_session);
+}
+
+tash::tls::~tls(){
+    if(_session){
+        SSL_SESSION_free(_session);
+    }
+}
+
+int tash::tls::index(){
+    static const int idx = SSL_get_ex_new_index(0, 0, 0, 0, 0);
+    return idx;
+}
+
+int tash::tls::on_session(SSL* ssl, SSL_SESSION* session){
+    tash::tls* self = static_cast<tash::tls*>(SSL_get_ex_data(ssl, index()));
+    if(!self){
+        return 0;
+    }
+    boost::mutex::scoped_lock lock(self->_mutex);
+    if(self->_session){
+        SSL_SESSION_free(self->_session);
+    }
+    // returning 1 keeps the reference OpenSSL passed in
+    self->_session = session;
+    return 1;
+}
+
+std::unique_ptr<tash::tls_stream> tash::tls::wrap(tls_layer::socket_type& socket){
+    std::unique_ptr<tash::tls_stream> stream(new tash::tls_stream(socket, *_context));
+    SSL* ssl = stream->native_handle();
+    SSL_set_ex_data(ssl, index(), this);
+    boost::system::error_code ec;
+    boost::asio::ip::make_address(_host, ec);
+    if(ec){
+        // server name indication is only defined for host names, not for addresses
+        SSL_set_tlsext_host_name(ssl, _host.c_str());
+    }
+    stream->set_verify_callback(boost::asio::ssl::host_name_verification(_host));
+    boost::mutex::scoped_lock lock(_mutex);
+    if(_session){
+        SSL_set_session(ssl, _session);
+    }
+    return stream;
+}
+
+void tash::tls::handshaked(tash::tls_stream& stream, const boost::system::error_code& ec){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(ec){
+        ++_stats.failures;
+        if(_session){
+            // the server may have forgotten the session, the next attempt starts over
+            SSL_SESSION_free(_session);
+            _session = 0;
+        }
+        return;
+    }
+    ++_stats.handshakes;
+    if(SSL_session_reused(stream.native_handle())){
+        ++_stats.resumed;
+    }
+}
+
+void tash::tls::forget(){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(_session){
+        SSL_SESSION_free(_session);
+        _session = 0;
+    }
+}
+
+tash::tls::statistics tash::tls::stats() const{
+    boost::mutex::scoped_lock lock(_mutex);
+    return _stats;
+}
+
+boost::shared_ptr<boost::asio::ssl::context> tash::tls::client(){
+    boost::shared_ptr<boost::asio::ssl::context> context = boost::make_shared<boost::asio::ssl::context>(boost::asio::ssl::context::tls_client);
+    context->set_options(boost::asio::ssl::context::default_workarounds | boost::asio::ssl::context::no_sslv2 | boost::asio::ssl::context::no_sslv3);
+    context->set_default_verify_paths();
+    context->set_verify_mode(boost::asio::ssl::verify_peer);
+    return context;
+}
@@ -0,0 +1,427 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/vpack.h"
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+namespace{
+    
+    std::uint64_t read_uint(const std::uint8_t* p, std::size_t width){
+        std::uint64_t value = 0;
+        for(std::size_t i = 0; i < width; ++i){
+            value |= static_cast<std::uint64_t>(p[i]) << (8*i);
+        }
+        return value;
+    }
+    
+    void write_uint(std::string& out, std::uint64_t value, std::size_t width){
+        for(std::size_t i = 0; i < width; ++i){
+            out.push_back(static_cast<char>((value >> (8*i)) & 0xff));
+        }
+    }
+    
+    /**
+     * variable length integer, 7 bits per byte with the high bit set on every byte but the last
+     * the item count of compact arrays and objects is stored backwards from their end, read it with reverse = true
+     */
+    std::uint64_t read_varint(const std::uint8_t* p, bool reverse, std::size_t* length = nullptr){
+        std::uint64_t value = 0;
+        std::size_t i = 0;
+        for(unsigned shift = 0; shift < 64; shift += 7){
+            std::uint8_t byte = reverse ? *(p - i) : p[i];
+            ++i;
+            value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+            if(!(byte & 0x80)){
+                if(length){
+                    *length = i;
+                }
+                return value;
+            }
+        }
+        throw std::invalid_argument("velocypack variable length integer too long");
+    }
+    
+    /**
+     * width of the byte length, item count and offsets of an array or object with index table
+     */
+    std::size_t width(std::uint8_t type, std::uint8_t first){
+        return std::size_t(1) << ((type - first) % 4);
+    }
+    
+    void check(std::size_t needed, std::size_t available){
+        if(needed > available){
+            throw std::invalid_argument("truncated velocypack value");
+        }
+    }
+    
+    nlohmann::json value(const std::uint8_t* data, std::size_t available);
+    
+    std::string attribute(const std::uint8_t* data, std::size_t available){
+        std::uint8_t type = data[0];
+        if(type >= 0x40 && type <= 0xbf){
+            nlohmann::json key = value(data, available);
+            return key.get<std::string>();
+        }
+        // ArangoDB replaces its system attribute names with small integers
+        std::uint64_t id = type >= 0x30 && type <= 0x39 ? std::uint64_t(type - 0x30) : value(data, available).get<std::uint64_t>();
+        switch(id){
+            case 1: return "_key";
+            case 2: return "_rev";
+            case 3: return "_id";
+            case 4: return "_from";
+            case 5: return "_to";
+        }
+        return std::to_string(id);
+    }
+    
+    /**
+     * offsets of the members of an array or object with index table, relative to data
+     */
+    std::vector<std::uint64_t> index(const std::uint8_t* data, std::size_t length, std::size_t w){
+        std::uint64_t count;
+        std::size_t table;
+        if(w < 8){
+            check(1+2*w, length);
+            count = read_uint(data+1+w, w);
+            table = length - count*w;
+        }else{
+            check(1+8+8, length);
+            count = read_uint(data+length-8, 8);
+            table = length - 8 - count*8;
+        }
+        if(count > length || table > length){
+            throw std::invalid_argument("invalid velocypack index table");
+        }
+        std::vector<std::uint64_t> offsets;
+        offsets.reserve(count);
+        for(std::uint64_t i = 0; i < count; ++i){
+            std::uint64_t offset = read_uint(data+table+i*w, w);
+            if(offset >= table){
+                throw std::invalid_argument("invalid velocypack offset");
+            }
+            offsets.push_back(offset);
+        }
+        return offsets;
+    }
+    
+    nlohmann::json value(const std::uint8_t* data, std::size_t available){
+        check(1, available);
+        const std::size_t length = tash::vpack::size(data, available);
+        const std::uint8_t type = data[0];
+        if(type == 0x01){
+            return nlohmann::json::array();
+        }
+        if(type == 0x0a){
+            return nlohmann::json::object();
+        }
+        if(type >= 0x02 && type <= 0x05){
+            // equally sized members without index table, zero bytes may pad the header
+            nlohmann::json array = nlohmann::json::array();
+            std::size_t offset = 1 + width(type, 0x02);
+            while(offset < length && data[offset] == 0x00){
+                ++offset;
+            }
+            while(offset < length){
+                std::size_t member = tash::vpack::size(data+offset, length-offset);
+                array.push_back(value(data+offset, length-offset));
+                offset += member;
+            }
+            return array;
+        }
+        if(type >= 0x06 && type <= 0x09){
+            nlohmann::json array = nlohmann::json::array();
+            for(std::uint64_t offset: index(data, length, width(type, 0x06))){
+                array.push_back(value(data+offset, length-offset));
+            }
+            return array;
+        }
+        if(type >= 0x0b && type <= 0x12){
+            nlohmann::json object = nlohmann::json::object();
+            for(std::uint64_t offset: index(data, length, width(type, type <= 0x0e ? 0x0b : 0x0f))){
+                std::size_t key = tash::vpack::size(data+offset, length-offset);
+                object[attribute(data+offset, length-offset)] = value(data+offset+key, length-offset-key);
+            }
+            return object;
+        }
+        if(type == 0x13 || type == 0x14){
+            std::size_t header;
+            read_varint(data+1, false, &header);
+            std::size_t trailer;
+            std::uint64_t count = read_varint(data+length-1, true, &trailer);
+            nlohmann::json compound = type == 0x13 ? nlohmann::json::array() : nlohmann::json::object();
+            std::size_t offset = 1 + header;
+            const std::size_t end = length - trailer;
+            for(std::uint64_t i = 0; i < count; ++i){
+                check(offset+1, end);
+                std::size_t member = tash::vpack::size(data+offset, end-offset);
+                if(type == 0x13){
+                    compound.push_back(value(data+offset, end-offset));
+                }else{
+                    std::string key = attribute(data+offset, end-offset);
+                    offset += member;
+                    check(offset+1, end);
+                    member = tash::vpack::size(data+offset, end-offset);
+                    compound[key] = value(data+offset, end-offset);
+                }
+                offset += member;
+            }
+            return compound;
+        }
+        switch(type){
+            case 0x18: return nullptr;
+            case 0x19: return false;
+            case 0x1a: return true;
+            case 0x1b:{
+                std::uint64_t bits = read_uint(data+1, 8);
+                double number;
+                std::memcpy(&number, &bits, sizeof(number));
+                return number;
+            }
+            case 0x1c: return static_cast<std::int64_t>(read_uint(data+1, 8));
+        }
+        if(type >= 0x20 && type <= 0x27){
+            std::size_t bytes = type - 0x1f;
+            std::uint64_t bits = read_uint(data+1, bytes);
+            if(bytes < 8 && (bits >> (8*bytes-1)) & 1){
+                // sign extension
+                bits |= ~std::uint64_t(0) << (8*bytes);
+            }
+            return static_cast<std::int64_t>(bits);
+        }
+        if(type >= 0x28 && type <= 0x2f){
+            return read_uint(data+1, type - 0x27);
+        }
+        if(type >= 0x30 && type <= 0x39){
+            return type - 0x30;
+        }
+        if(type >= 0x3a && type <= 0x3f){
+            return static_cast<int>(type) - 0x40;
+        }
+        if(type >= 0x40 && type <= 0xbe){
+            return std::string(reinterpret_cast<const char*>(data+1), type - 0x40);
+        }
+        if(type == 0xbf){
+            return std::string(reinterpret_cast<const char*>(data+9), length - 9);
+        }
+        if(type >= 0xc0 && type <= 0xc7){
+            std::size_t bytes = type - 0xbf;
+            return std::string(reinterpret_cast<const char*>(data+1+bytes), length-1-bytes);
+        }
+        throw std::invalid_argument("unsupported velocypack type "+std::to_string(type));
+    }
+    
+    void encode(const nlohmann::json& document, std::string& out);
+    
+    /**
+     * writes an array (0x06 - 0x09) or a sorted object (0x0b - 0x0e) whose members have been encoded into payload
+     */
+    void compound(std::uint8_t first, const std::string& payload, const std::vector<std::size_t>& offsets, std::string& out){
+        const std::uint64_t count = offsets.size();
+        std::size_t w = 1;
+        for(; w < 8; w *= 2){
+            std::uint64_t limit = std::uint64_t(1) << (8*w);
+            if(1 + 2*w + payload.size() + count*w < limit && count < limit){
+                break;
+            }
+        }
+        const std::size_t head = w < 8 ? 1 + 2*w : 1 + 8;
+        const std::uint64_t length = head + payload.size() + count*w + (w < 8 ? 0 : 8);
+        out.push_back(static_cast<char>(first + (w == 1 ? 0 : w == 2 ? 1 : w == 4 ? 2 : 3)));
+        write_uint(out, length, w);
+        if(w < 8){
+            write_uint(out, count, w);
+        }
+        out.append(payload);
+        for(std::size_t offset: offsets){
+            write_uint(out, head + offset, w);
+        }
+        if(w == 8){
+            write_uint(out, count, 8);
+        }
+    }
+    
+    void encode(const nlohmann::json& document, std::string& out){
+        switch(document.type()){
+            case nlohmann::json::value_t::null:
+            case nlohmann::json::value_t::discarded:
+                out.push_back(0x18);
+                return;
+            case nlohmann::json::value_t::boolean:
+                out.push_back(document.get<bool>() ? 0x1a : 0x19);
+                return;
+            case nlohmann::json::value_t::number_float:{
+                double number = document.get<double>();
+                std::uint64_t bits;
+                std::memcpy(&bits, &number, sizeof(bits));
+                out.push_back(0x1b);
+                write_uint(out, bits, 8);
+                return;
+            }
+            case nlohmann::json::value_t::number_integer:{
+                std::int64_t number = document.get<std::int64_t>();
+                if(number >= -6 && number <= 9){
+                    out.push_back(static_cast<char>(number >= 0 ? 0x30 + number : 0x40 + number));
+                    return;
+                }
+                std::size_t bytes = 1;
+                while(bytes < 8 && (number < -(std::int64_t(1) << (8*bytes-1)) || number >= (std::int64_t(1) << (8*bytes-1)))){
+                    ++bytes;
+                }
+                out.push_back(static_cast<char>(0x1f + bytes));
+                write_uint(out, static_cast<std::uint64_t>(number), bytes);
+                return;
+            }
+            case nlohmann::json::value_t::number_unsigned:{
+                std::uint64_t number = document.get<std::uint64_t>();
+                if(number <= 9){
+                    out.push_back(static_cast<char>(0x30 + number));
+                    return;
+                }
+                std::size_t bytes = 1;
+                while(bytes < 8 && number >= (std::uint64_t(1) << (8*bytes))){
+                    ++bytes;
+                }
+                out.push_back(static_cast<char>(0x27 + bytes));
+                write_uint(out, number, bytes);
+                return;
+            }
+            case nlohmann::json::value_t::string:{
+                const std::string& text = document.get_ref<const std::string&>();
+                if(text.size() <= 126){
+                    out.push_back(static_cast<char>(0x40 + text.size()));
+                }else{
+                    out.push_back(static_cast<char>(0xbf));
+                    write_uint(out, text.size(), 8);
+                }
+                out.append(text);
+                return;
+            }
+#if defined(TASH_JSON_HAS_BINARY)
+            case nlohmann::json::value_t::binary:{
+                const nlohmann::json::binary_t& bytes = document.get_binary();
+                std::size_t w = 1;
+                while(w < 8 && bytes.size() >= (std::uint64_t(1) << (8*w))){
+                    ++w;
+                }
+                out.push_back(static_cast<char>(0xbf + w));
+                write_uint(out, bytes.size(), w);
+                out.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+                return;
+            }
+#endif
+            case nlohmann::json::value_t::array:{
+                if(document.empty()){
+                    out.push_back(0x01);
+                    return;
+                }
+                std::string payload;
+                std::vector<std::size_t> offsets;
+                offsets.reserve(document.size());
+                for(const nlohmann::json& member: document){
+                    offsets.push_back(payload.size());
+                    encode(member, payload);
+                }
+                compound(0x06, payload, offsets, out);
+                return;
+            }
+            case nlohmann::json::value_t::object:{
+                if(document.empty()){
+                    out.push_back(0x0a);
+                    return;
+                }
+                // nlohmann::json keeps the attributes in a std::map, so they are already in the byte order the sorted index table requires
+                std::string payload;
+                std::vector<std::size_t> offsets;
+                offsets.reserve(document.size());
+                for(auto it = document.begin(); it != document.end(); ++it){
+                    offsets.push_back(payload.size());
+                    encode(nlohmann::json(it.key()), payload);
+                    encode(it.value(), payload);
+                }
+                compound(0x0b, payload, offsets, out);
+                return;
+            }
+        }
+    }
+    
+}
+
+std::size_t tash::vpack::size(const std::uint8_t* data, std::size_t available){
+    check(1, available);
+    const std::uint8_t type = data[0];
+    std::size_t length = 1;
+    if(type >= 0x02 && type <= 0x09){
+        std::size_t w = width(type, type <= 0x05 ? 0x02 : 0x06);
+        check(1+w, available);
+        length = read_uint(data+1, w);
+    }else if(type >= 0x0b && type <= 0x12){
+        std::size_t w = width(type, type <= 0x0e ? 0x0b : 0x0f);
+        check(1+w, available);
+        length = read_uint(data+1, w);
+    }else if(type == 0x13 || type == 0x14){
+        check(2, available);
+        length = read_varint(data+1, false);
+    }else if(type == 0x1b || type == 0x1c){
+        length = 9;
+    }else if(type >= 0x20 && type <= 0x27){
+        length = 1 + type - 0x1f;
+    }else if(type >= 0x28 && type <= 0x2f){
+        length = 1 + type - 0x27;
+    }else if(type >= 0x40 && type <= 0xbe){
+        length = 1 + type - 0x40;
+    }else if(type == 0xbf){
+        check(9, available);
+        length = 9 + read_uint(data+1, 8);
+    }else if(type >= 0xc0 && type <= 0xc7){
+        std::size_t bytes = type - 0xbf;
+        check(1+bytes, available);
+        length = 1 + bytes + read_uint(data+1, bytes);
+    }else if(type == 0x00 || type == 0x15 || type == 0x16 || type == 0x17 || type == 0x1d || type >= 0xc8){
+        throw std::invalid_argument("unsupported velocypack type "+std::to_string(type));
+    }
+    if(length == 0){
+        throw std::invalid_argument("invalid velocypack length");
+    }
+    check(length, available);
+    return length;
+}
+
+std::string tash::vpack::encode(const nlohmann::json& document){
+    std::string out;
+    ::encode(document, out);
+    return out;
+}
+
+nlohmann::json tash::vpack::decode(const std::uint8_t* data, std::size_t size){
+    return value(data, size);
+}
+
+nlohmann::json tash::vpack::decode(const std::string& data){
+    return decode(reinterpret_cast<const std::uint8_t*>(data.data()), data.size());
+}
@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2018, Sunanda Bose (Neel Basu) (neel.basu.z@gmail.com) 
+ * All rights reserved. 
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met: 
+ * 
+ *  * Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer. 
+ *  * Redistributions in binary form must reproduce the above copyright 
+ *    notice, this list of conditions and the following disclaimer in the 
+ *    documentation and/or other materials provided with the distribution. 
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND ANY 
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED 
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE 
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE FOR ANY 
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES 
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR 
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT 
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY 
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH 
+ * DAMAGE. 
+ */
+
+
+#include "tash/vst.h"
+#include "tash/vpack.h"
+#include "tash/pool.h"
+#include <future>
+#include <memory>
+#include <cctype>
+#include <stdexcept>
+#include <boost/algorithm/string/predicate.hpp>
+
+namespace{
+    
+    std::uint64_t read_uint(const char* p, std::size_t width){
+        std::uint64_t value = 0;
+        for(std::size_t i = 0; i < width; ++i){
+            value |= static_cast<std::uint64_t>(static_cast<unsigned char>(p[i])) << (8*i);
+        }
+        return value;
+    }
+    
+    void write_uint(std::string& out, std::uint64_t value, std::size_t width){
+        for(std::size_t i = 0; i < width; ++i){
+            out.push_back(static_cast<char>((value >> (8*i)) & 0xff));
+        }
+    }
+    
+    std::string unescape(boost::beast::string_view text){
+        std::string out;
+        out.reserve(text.size());
+        for(std::size_t i = 0; i < text.size(); ++i){
+            if(text[i] == '%' && i+2 < text.size() && std::isxdigit(text[i+1]) && std::isxdigit(text[i+2])){
+                out.push_back(static_cast<char>(std::stoi(std::string(text.substr(i+1, 2)), nullptr, 16)));
+                i += 2;
+            }else if(text[i] == '+'){
+                out.push_back(' ');
+            }else{
+                out.push_back(text[i]);
+            }
+        }
+        return out;
+    }
+    
+    /**
+     * request types of the VelocyStream header
+     */
+    int method_code(boost::beast::http::verb method){
+        switch(method){
+            case boost::beast::http::verb::delete_: return 0;
+            case boost::beast::http::verb::get:     return 1;
+            case boost::beast::http::verb::post:    return 2;
+            case boost::beast::http::verb::put:     return 3;
+            case boost::beast::http::verb::head:    return 4;
+            case boost::beast::http::verb::patch:   return 5;
+            case boost::beast::http::verb::options: return 6;
+            default: break;
+        }
+        throw std::invalid_argument("method not supported by VelocyStream: "+std::string(boost::beast::http::to_string(method)));
+    }
+    
+    /**
+     * turns a VelocyStream response message, a VelocyPack header followed by the body, into an HTTP response
+     */
+    tash::velocystream::response_type response(const std::string& data){
+        const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(data.data());
+        std::size_t head_size = tash::vpack::size(bytes, data.size());
+        nlohmann::json head = tash::vpack::decode(bytes, head_size);
+        // [version, type, response code, meta]
+        tash::velocystream::response_type res;
+        res.version(11);
+        res.result(head.at(2).get<unsigned>());
+        if(head.size() > 3 && head[3].is_object()){
+            for(auto it = head[3].begin(); it != head[3].end(); ++it){
+                if(it.value().is_string()){
+                    res.set(it.key(), it.value().get<std::string>());
+                }
+            }
+        }
+        std::size_t body_size = data.size() - head_size;
+        if(body_size > 0 && res.find(boost::beast::http::field::content_type) == res.end()){
+            res.set(boost::beast::http::field::content_type, "application/x-velocypack");
+        }
+        res.body().commit(boost::asio::buffer_copy(res.body().prepare(body_size), boost::asio::buffer(data.data()+head_size, body_size)));
+        res.keep_alive(true);
+        res.prepare_payload();
+        return res;
+    }
+}
+
+tash::velocystream::velocystream(tash::dns_cache& dns, const std::string& user, const std::string& pass)
+    : _work(boost::asio::make_work_guard(_io)), _socket(_io), _dns(dns), _user(user), _pass(pass), _chunk_size(30000), _connected(false), _generation(0), _next(1), _writing(false){
+    _thread = boost::thread([this](){
+        _io.run();
+    });
+}
+
+tash::velocystream::~velocystream(){
+    _work.reset();
+    _io.stop();
+    _thread.join();
+    for(auto& pending: _pending){
+        pending.second._handler(boost::asio::error::operation_aborted, response_type(), true);
+    }
+}
+
+tash::velocystream& tash::velocystream::chunk_size(std::size_t size){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(size <= 24){
+        throw std::invalid_argument("the chunk size has to exceed the 24 byte chunk header");
+    }
+    _chunk_size = size;
+    return *this;
+}
+
+std::size_t tash::velocystream::pending(){
+    boost::mutex::scoped_lock lock(_mutex);
+    return _pending.size();
+}
+
+void tash::velocystream::connect(){
+    connect(tash::deadline(tash::request_options()));
+}
+
+void tash::velocystream::connect(const tash::deadline& deadline){
+    boost::mutex::scoped_lock lock(_mutex);
+    if(_connected){
+        return;
+    }
+    boost::system::error_code ec = boost::asio::error::host_not_found;
+    for(const tash::dns_cache::endpoint_type& endpoint: _dns.endpoints()){
+        tash::connect(_socket, endpoint, deadline, ec);
+        if(!ec){
+            _dns.prefer(endpoint);
+            break;
+        }
+        if(deadline.check(deadline.total())){
+            throw boost::system::system_error(ec);
+        }
+        _dns.failed(endpoint);
+    }
+    if(ec){
+        _dns.invalidate();
+        throw boost::system::system_error(ec);
+    }
+    try{
+        tash::channel::no_delay(_socket);
+        tash::deadline_stream stream(_socket, deadline);
+        boost::asio::write(stream, boost::asio::buffer("VST/1.1\r\n\r\n", 11));
+        if(!_user.empty()){
+            // nothing else is in flight yet, so the chunks read here all belong to the authentication
+            std::string message = tash::vpack::encode(nlohmann::json::array({1, 1000, "plain", _user, _pass}));
+            boost::asio::write(stream, boost::asio::buffer(chunks(_next++, message)));
+            std::string data;
+            std::uint64_t length = 1;
+            while(data.size() < length){
+                boost::asio::read(stream, boost::asio::buffer(_header, sizeof(_header)));
+                std::string chunk(read_uint(_header, 4) - sizeof(_header), '\0');
+                boost::asio::read(stream, boost::asio::buffer(&chunk[0], chunk.size()));
+                length = read_uint(_header+16, 8);
+                data.append(chunk);
+            }
+            if(response(data).result() != boost::beast::http::status::ok){
+                throw boost::system::system_error(boost::system::errc::make_error_code(boost::system::errc::permission_denied));
+            }
+        }
+    }catch(const std::exception&){
+        boost::system::error_code ignored;
+        _socket.close(ignored);
+        throw;
+    }
+    _connected = true;
+    std::size_t generation = ++_generation;
+    boost::asio::post(_io, [this, generation](){
+        read(generation);
+    });
+}
+
+tash::velocystream::response_type tash::velocystream::send(const request_type& request){
+    return send(request, tash::deadline(tash::request_options()));
+}
+
+tash::velocystream::response_type tash::velocystream::send(const request_type& request, const tash::deadline& deadline){
+    std::string content = message(request);
+    connect(deadline);
+    std::shared_ptr<std::promise<response_type>> promise = std::make_shared<std::promise<response_type>>();
+    std::future<response_type> future = promise->get_future();
+    handler_type handler = [promise](boost::system::error_code ec, response_type res, bool){
+        if(ec){
+            promise->set_exception(std::make_exception_ptr(boost::system::system_error(ec)));
+        }else{
+            promise->set_value(std::move(res));
+        }
+    };
+    std::uint64_t id;
+    std::size_t generation;
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        id = _next++;
+        generation = _generation;
+        _pending[id] = incoming{handler, std::string(), 0};
+    }
+    std::string data = chunks(id, content);
+    boost::asio::post(_io, [this, generation, data](){
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            if(generation != _generation){
+                // the socket failed in the meantime and the request has been failed with it
+                return;
+            }
+        }
+        enqueue(data);
+    });
+    // a cancellable wait wakes up regularly to look at the token
+    const std::chrono::milliseconds slice(50);
+    while(true){
+        boost::system::error_code ec = deadline.check(deadline.total());
+        if(ec){
+            boost::mutex::scoped_lock lock(_mutex);
+            if(_pending.erase(id) > 0){
+                throw boost::system::system_error(ec);
+            }
+            // the response is being handed over right now
+            break;
+        }
+        std::chrono::steady_clock::time_point until = deadline.total();
+        if(deadline.token() && (until == std::chrono::steady_clock::time_point::max() || until - std::chrono::steady_clock::now() > slice)){
+            until = std::chrono::steady_clock::now() + slice;
+        }
+        if(until == std::chrono::steady_clock::time_point::max()){
+            future.wait();
+            break;
+        }
+        if(future.wait_until(until) == std::future_status::ready){
+            break;
+        }
+    }
+    return future.get();
+}
+
+std::uint64_t tash::velocystream::start(const request_type& request, const tash::deadline& deadline, handler_type handler){
+    std::string content;
+    try{
+        content = message(request);
+    }catch(const std::exception&){
+        handler(boost::system::errc::make_error_code(boost::system::errc::invalid_argument), response_type(), false);
+        return 0;
+    }
+    std::uint64_t id;
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        id = _next++;
+    }
+    boost::asio::post(_io, [this, id, content, deadline, handler](){
+        // blocks the thread of the socket, but no longer than the request itself may take to connect
+        try{
+            connect(deadline);
+        }catch(const boost::system::system_error& error){
+            return handler(error.code(), response_type(), false);
+        }
+        {
+            boost::mutex::scoped_lock lock(_mutex);
+            _pending[id] = incoming{handler, std::string(), 0};
+        }
+        enqueue(chunks(id, content));
+    });
+    return id;
+}
+
+void tash::velocystream::abandon(std::uint64_t id){
+    // posted behind the start() of the request, so the request is pending by then unless it completed
+    boost::asio::post(_io, [this, id](){
+        boost::mutex::scoped_lock lock(_mutex);
+        _pending.erase(id);
+    });
+}
+
+std::string tash::velocystream::message(const request_type& request) const{
+    boost::beast::string_view target = request.target();
+    boost::beast::string_view query;
+    std::size_t question = target.find('?');
+    if(question != boost::beast::string_view::npos){
+        query  = target.substr(question+1);
+        target = target.substr(0, question);
+    }
+    std::string database("_system");
+    if(boost::algorithm::starts_with(target, "/_db/")){
+        std::size_t slash = target.find('/', 5);
+        database = unescape(target.substr(5, slash == boost::beast::string_view::npos ? boost::beast::string_view::npos : slash-5));
+        target   = slash == boost::beast::string_view::npos ? boost::beast::string_view("/") : target.substr(slash);
+    }
+    nlohmann::json parameters = nlohmann::json::object();
+    while(!query.empty()){
+        std::size_t amp = query.find('&');
+        boost::beast::string_view pair = query.substr(0, amp);
+        query = amp == boost::beast::string_view::npos ? boost::beast::string_view() : query.substr(amp+1);
+        std::size_t equals = pair.find('=');
+        if(equals == boost::beast::string_view::npos){
+            parameters[unescape(pair)] = "";
+        }else{
+            parameters[unescape(pair.substr(0, equals))] = unescape(pair.substr(equals+1));
+        }
+    }
+    nlohmann::json meta = nlohmann::json::object();
+    for(const auto& field: request){
+        // authentication happens once per socket and framing replaces the remaining connection level headers
+        if(field.name() == boost::beast::http::field::host || field.name() == boost::beast::http::field::authorization || field.name() == boost::beast::http::field::connection || field.name() == boost::beast::http::field::content_length){
+            continue;
+        }
+        std::string name(field.name_string());
+        for(char& c: name){
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        meta[name] = std::string(field.value());
+    }
+    nlohmann::json header = nlohmann::json::array({1, 1, database, method_code(request.method()), unescape(target), parameters, meta});
+    return tash::vpack::encode(header) + request.body();
+}
+
+std::string tash::velocystream::chunks(std::uint64_t id, const std::string& message) const{
+    const std::size_t payload = _chunk_size - sizeof(_header);
+    const std::size_t count = message.empty() ? 1 : (message.size() + payload - 1) / payload;
+    std::string data;
+    data.reserve(message.size() + count*sizeof(_header));
+    for(std::size_t i = 0; i < count; ++i){
+        std::size_t length = std::min(payload, message.size() - i*payload);
+        write_uint(data, sizeof(_header) + length, 4);
+        // the first chunk carries the number of chunks, the others their index
+        write_uint(data, i == 0 ? (count << 1) | 1 : (i << 1), 4);
+        write_uint(data, id, 8);
+        write_uint(data, message.size(), 8);
+        data.append(message, i*payload, length);
+    }
+    return data;
+}
+
+void tash::velocystream::enqueue(std::string data){
+    _outgoing.push_back(std::move(data));
+    if(!_writing){
+        write();
+    }
+}
+
+void tash::velocystream::write(){
+    _writing = true;
+    std::size_t generation;
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        generation = _generation;
+    }
+    boost::asio::async_write(_socket, boost::asio::buffer(_outgoing.front()), [this, generation](boost::system::error_code ec, std::size_t){
+        if(ec){
+            _writing = false;
+            return fail(generation, ec);
+        }
+        _outgoing.pop_front();
+        if(_outgoing.empty()){
+            _writing = false;
+        }else{
+            write();
+        }
+    });
+}
+
+void tash::velocystream::read(std::size_t generation){
+    boost::asio::async_read(_socket, boost::asio::buffer(_header, sizeof(_header)), [this, generation](boost::system::error_code ec, std::size_t){
+        if(ec){
+            return fail(generation, ec);
+        }
+        std::uint64_t length = read_uint(_header, 4);
+        if(length < sizeof(_header)){
+            return fail(generation, boost::system::errc::make_error_code(boost::system::errc::bad_message));
+        }
+        _chunk.resize(length - sizeof(_header));
+        boost::asio::async_read(_socket, boost::asio::buffer(&_chunk[0], _chunk.size()), [this, generation](boost::system::error_code ec, std::size_t){
+            if(ec){
+                return fail(generation, ec);
+            }
+            received(generation);
+        });
+    });
+}
+
+void tash::velocystream::received(std::size_t generation){
+    const std::uint64_t id     = read_uint(_header+8, 8);
+    const std::uint64_t length = read_uint(_header+16, 8);
+    handler_type handler;
+    std::string data;
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        if(generation != _generation){
+            return;
+        }
+        auto it = _pending.find(id);
+        if(it != _pending.end()){
+            it->second._length = length;
+            it->second._data.append(_chunk);
+            if(it->second._data.size() >= it->second._length){
+                handler = std::move(it->second._handler);
+                data    = std::move(it->second._data);
+                _pending.erase(it);
+            }
+        }
+    }
+    if(handler){
+        response_type res;
+        boost::system::error_code ec;
+        try{
+            res = response(data);
+        }catch(const std::exception&){
+            ec = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+        }
+        handler(ec, std::move(res), true);
+    }
+    read(generation);
+}
+
+void tash::velocystream::fail(std::size_t generation, const boost::system::error_code& ec){
+    std::map<std::uint64_t, incoming> pending;
+    {
+        boost::mutex::scoped_lock lock(_mutex);
+        if(generation != _generation){
+            return;
+        }
+        ++_generation;
+        _connected = false;
+        boost::system::error_code ignored;
+        _socket.close(ignored);
+        pending.swap(_pending);
+    }
+    _outgoing.clear();
+    _writing = false;
+    for(auto& request: pending){
+        request.second._handler(ec, response_type(), true);
+    }
+}